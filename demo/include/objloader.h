@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -15,6 +16,8 @@ typedef struct Model
     GLuint vertex_array;
     GLuint face_index_count;
     std::string material_name;
+    glm::vec3 center;
+    float radius;
 } Model;
 
 typedef struct Material
@@ -37,6 +40,22 @@ typedef struct Group {
     std::vector<Face> faces;
 } Group;
 
+// Triangles with an edge spanning more than `max_span` degrees as seen from anywhere
+// within the reference viewing sphere are split at load time
+typedef struct SplitRegion {
+    glm::vec3 center;
+    float radius;
+    float max_span;
+    float min_edge_length;
+    glm::mat4 (*model_matrix)(glm::vec3 center, glm::vec3 size);
+} SplitRegion;
+
+typedef struct Corner {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texcoord;
+} Corner;
+
 class ObjLoader {
 private:
     std::vector<Model> _models;
@@ -46,11 +65,21 @@ private:
     GLuint _texcoord_attrib;
     glm::vec3 _center;
     glm::vec3 _size;
+    SplitRegion *_split_region;
+    glm::mat4 _split_model_matrix;
 
     int findGroupByName(std::vector<Group> &groups, std::string material_name);
+    void splitFaces(std::vector<glm::vec3> &vertices,
+                    std::vector<glm::vec3> &normals,
+                    std::vector<glm::vec2> &texcoords,
+                    std::vector<Group> &groups);
+    void splitTriangle(Corner corners[3], std::vector<Corner> &triangles);
+    bool splitEdge(glm::vec3 &a, glm::vec3 &b);
+    float edgeSpan(glm::vec3 &a, glm::vec3 &b);
+    Corner midpoint(Corner &a, Corner &b);
 
 public:
-    ObjLoader(const char *filename);
+    ObjLoader(const char *filename, SplitRegion *split_region = NULL);
     ~ObjLoader();
 
     void readObjFile(const char *filename, std::vector<glm::vec3> &vertices,
@@ -1,5 +1,17 @@
 #version 410 core
 
+// compile-time specialization (defines injected by the application)
+#ifdef NUM_LIGHTS
+#define LIGHT_COUNT NUM_LIGHTS
+#else
+#define LIGHT_COUNT num_lights
+#endif
+#ifdef NUM_SPOTLIGHTS
+#define SPOTLIGHT_COUNT NUM_SPOTLIGHTS
+#else
+#define SPOTLIGHT_COUNT num_spotlights
+#endif
+
 in vec3 world_position;
 in vec3 world_normal;
 in vec2 model_texcoord;
@@ -31,7 +43,7 @@ void main() {
     float full_light_dist = 1.5;
     float no_light_dist = 15.0;
     float attenuation_k = 1.0 / (full_light_dist * full_light_dist);
-    for(i = 0; i < num_lights; i++) {
+    for(i = 0; i < LIGHT_COUNT; i++) {
         vec3 light_vector = light_position[i] - world_position;
         float dist = length(light_vector);
         if (dist < no_light_dist) {
@@ -49,7 +61,7 @@ void main() {
         }
     }
 
-    for(i = 0; i < num_spotlights; i++) {
+    for(i = 0; i < SPOTLIGHT_COUNT; i++) {
         float full_spotlight_dist = spotlight_attenuation[i].x;
         float no_spotlight_dist = spotlight_attenuation[i].y;
         float attenuation_sk = 1.0 / (full_spotlight_dist * full_spotlight_dist);
@@ -20,6 +20,9 @@
 
 //#define OFFSCREEN
 
+#define VARIANT_NO_POLE 1
+#define VARIANT_NO_SEAM 2
+
 typedef struct GlslProgram {
     GLuint program;
     std::map<std::string, GLint> uniforms;
@@ -56,6 +59,8 @@ typedef struct App {
     glm::vec4 taillight_dir;
     float camera_offset;
     float camera_angle;
+    float tess_edge_pixels;
+    float split_span;
     glm::vec3 car_position;
     float car_orientation;
     int num_lights;
@@ -81,12 +86,18 @@ void idle(GLFWwindow *window, App &app);
 void render(GLFWwindow *window, App &app);
 void onKeyboard(GLFWwindow *window, int key, int scancode, int action, int mods);
 void saveImage(const char *filename, App &app);
-void loadShader(std::string key, std::string shader_filename_base, App &app);
+void loadShader(std::string key, std::string shader_filename_base, App &app,
+                std::vector<std::string> defines = std::vector<std::string>());
+GlslProgram& useProgram(std::string name, int variant, int num_lights, int num_spotlights, App &app);
+GLint uniformLocation(std::map<std::string, GLint> &uniforms, std::string name);
+std::string injectDefines(const char *source, int32_t length, std::vector<std::string> &defines);
+int classifyModel(Model &model, glm::mat4 &model_matrix, App &app);
 GLint compileShader(char *source, int32_t length, GLenum type);
 GLuint createShaderProgram(GLuint shaders[], uint32_t num_shaders);
 void linkShaderProgram(GLuint program);
 std::string shaderTypeToString(GLenum type);
 int32_t readFile(const char* filename, char** data_ptr);
+glm::mat4 buildingsModelMatrix(glm::vec3 center, glm::vec3 size);
 GLuint createSphereVao(GLuint position_attrib, GLuint normal_attrib, GLuint texcoord_attrib, GLuint *face_index_count);
 
 int main(int argc, char **argv)
@@ -95,10 +106,19 @@ int main(int argc, char **argv)
     int height = 720;
     std::string save_filename = "frame";
     float camera_offset = 0.0f;
+    float tess_quality = 1.0f;
+    float split_span = 0.0f;
     if (argc >= 2) width = std::stoi(argv[1]);
     if (argc >= 3) height = std::stoi(argv[2]);
     if (argc >= 4) save_filename = argv[3];
     if (argc >= 5) camera_offset = std::stof(argv[4]);
+    if (argc >= 6) tess_quality = std::stof(argv[5]);
+    if (argc >= 7) split_span = std::stof(argv[6]);
+    if (!(tess_quality > 0.0f))
+    {
+        fprintf(stderr, "Error: tessellation quality must be positive\n");
+        exit(1);
+    }
 
     // Initialize GLFW
     if (!glfwInit())
@@ -136,6 +156,8 @@ int main(int argc, char **argv)
     // Initialize app
     App app;
     app.camera_offset = camera_offset;
+    app.tess_edge_pixels = 32.0f / tess_quality;
+    app.split_span = split_span;
     app.save_filename = save_filename;
     init(window, app, width, height);
 
@@ -228,21 +250,21 @@ void init(GLFWwindow *window, App &app, int width, int height)
     app.vertex_normal_attrib = 1;
     app.vertex_texcoord_attrib = 2;
 
-    loadShader("color", "resrc/shaders/equirect/color_equirect", app);
-    loadShader("texture", "resrc/shaders/equirect/texture_equirect", app);
-    loadShader("nolight_tex", "resrc/shaders/equirect/nolight_tex_equirect", app);
-    loadShader("nolight_col", "resrc/shaders/equirect/nolight_col_equirect", app);
-
-    app.buildings = new ObjLoader("resrc/models/buildings/buildings_small.obj");
+    // shader permutations are compiled on first use (see `useProgram`)
+
+    // optionally pre-split building / ground triangles that span a large angle from the viewing area
+    // (keeps tessellation levels low at the cost of more vertices)
+    SplitRegion buildings_split;
+    buildings_split.center = glm::vec3(-15.75, 1.72, 1.75);
+    buildings_split.radius = 1.0;
+    buildings_split.max_span = app.split_span;
+    buildings_split.min_edge_length = 0.05;
+    buildings_split.model_matrix = buildingsModelMatrix;
+    app.buildings = new ObjLoader("resrc/models/buildings/buildings_small.obj", (app.split_span > 0.0f) ? &buildings_split : NULL);
     app.car = new ObjLoader("resrc/models/dodge_challenger/dodge_challenger.obj");
     app.skybox = new ObjLoader("resrc/models/skybox_night/skybox_night.obj");
     app.sphere_vertex_array = createSphereVao(app.vertex_position_attrib, app.vertex_normal_attrib, app.vertex_texcoord_attrib, &(app.sphere_face_index_count));
 
-    glm::vec3 buildings_center = app.buildings->getCenter();
-    glm::vec3 buildings_size = app.buildings->getSize();
-    float scale_factor_buildings = 1.0f / (std::max(buildings_size.x, std::max(buildings_size.y, buildings_size.z)));
-    glm::vec3 buildings_location = (-1.0f * buildings_center) + glm::vec3(0.0f, buildings_size.y / 2.0f, 1.0f);
-
     glm::vec3 car_center = app.car->getCenter();
     glm::vec3 car_size = app.car->getSize();
     float scale_factor_car = 1.0f / (std::max(car_size.x, std::max(car_size.y, car_size.z)));
@@ -256,9 +278,7 @@ void init(GLFWwindow *window, App &app, int width, int height)
     app.mat4_view = glm::lookAt(app.camera_position, target, glm::vec3(0.0, 1.0, 0.0));
 
     // Buildings
-    app.mat4_model_buildings = glm::scale(glm::mat4(1.0), glm::vec3(scale_factor_buildings, scale_factor_buildings, scale_factor_buildings));
-    app.mat4_model_buildings = glm::scale(app.mat4_model_buildings, glm::vec3(75.0, 75.0, 75.0));
-    app.mat4_model_buildings = glm::translate(app.mat4_model_buildings, buildings_location);
+    app.mat4_model_buildings = buildingsModelMatrix(app.buildings->getCenter(), app.buildings->getSize());
 
     app.mat3_normal_buildings = glm::inverse(app.mat4_model_buildings);
     app.mat3_normal_buildings = glm::transpose(app.mat3_normal_buildings);
@@ -490,53 +510,56 @@ void render(GLFWwindow *window, App &app)
     for (i = 0; i < models.size(); i++)
     {
         std::string program_name;
+        int variant = classifyModel(models[i], app.mat4_model_buildings, app);
         Material mat = app.buildings->getMaterial(models[i].material_name);
         if (models[i].material_name == "15_-_Default.003")
         {
-            glUseProgram(app.glsl_program["nolight_col"].program);
             program_name = "nolight_col";
             mat.color = glm::vec3(0.894, 0.757, 0.439);
         }
         else if (mat.has_texture){
-            glUseProgram(app.glsl_program["texture"].program);
             program_name = "texture";
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mat.texture_id);
-            glUniform1i(app.glsl_program[program_name].uniforms["image"], 0);
         }
         else
         {
-            glUseProgram(app.glsl_program["color"].program);
             program_name = "color";
         }
+        bool lit = program_name != "nolight_col";
+        GlslProgram &program = useProgram(program_name, variant, lit ? app.num_lights : -1, lit ? app.num_spotlights : -1, app);
+
+        if (program_name == "texture")
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, mat.texture_id);
+            glUniform1i(uniformLocation(program.uniforms, "image"), 0);
+        }
 
-        if (program_name != "nolight_col")
+        if (lit)
         {
-            glUniform1i(app.glsl_program[program_name].uniforms["num_lights"], app.num_lights);
-            glUniform1i(app.glsl_program[program_name].uniforms["num_spotlights"], app.num_spotlights);
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_ambient"], 1, glm::value_ptr(app.light_ambient));
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_position[0]"], app.num_lights, app.light_position);
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_color[0]"], app.num_lights, app.light_color);
-            glUniform2fv(app.glsl_program[program_name].uniforms["pointlight_attenuation"], 1, light_attenuation);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_position[0]"], app.num_spotlights, app.spotlight_position);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_direction[0]"], app.num_spotlights, app.spotlight_direction);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_color[0]"], app.num_spotlights, app.spotlight_color);
-            glUniform2fv(app.glsl_program[program_name].uniforms["spotlight_attenuation[0]"], app.num_spotlights, app.spotlight_attenuation);
-            glUniform1fv(app.glsl_program[program_name].uniforms["spotlight_fov[0]"], app.num_spotlights, app.spotlight_fov);
+            glUniform1i(uniformLocation(program.uniforms, "num_lights"), app.num_lights);
+            glUniform1i(uniformLocation(program.uniforms, "num_spotlights"), app.num_spotlights);
+            glUniform3fv(uniformLocation(program.uniforms, "light_ambient"), 1, glm::value_ptr(app.light_ambient));
+            glUniform3fv(uniformLocation(program.uniforms, "light_position[0]"), app.num_lights, app.light_position);
+            glUniform3fv(uniformLocation(program.uniforms, "light_color[0]"), app.num_lights, app.light_color);
+            glUniform2fv(uniformLocation(program.uniforms, "pointlight_attenuation"), 1, light_attenuation);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_position[0]"), app.num_spotlights, app.spotlight_position);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_direction[0]"), app.num_spotlights, app.spotlight_direction);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_color[0]"), app.num_spotlights, app.spotlight_color);
+            glUniform2fv(uniformLocation(program.uniforms, "spotlight_attenuation[0]"), app.num_spotlights, app.spotlight_attenuation);
+            glUniform1fv(uniformLocation(program.uniforms, "spotlight_fov[0]"), app.num_spotlights, app.spotlight_fov);
         }
 
-        glUniform3fv(app.glsl_program[program_name].uniforms["camera_position"], 1, glm::value_ptr(app.camera_position));
-        glUniform1f(app.glsl_program[program_name].uniforms["camera_offset"], app.camera_offset);
+        glUniform3fv(uniformLocation(program.uniforms, "camera_position"), 1, glm::value_ptr(app.camera_position));
+        glUniform1f(uniformLocation(program.uniforms, "camera_offset"), app.camera_offset);
 
-        //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["projection_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_projection));
-        //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["view_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_view));
-        glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_buildings));
-        if (program_name != "nolight_col") glUniformMatrix3fv(app.glsl_program[program_name].uniforms["normal_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat3_normal_buildings));
+        //glUniformMatrix4fv(app.glsl_program[program_name + variant].uniforms["projection_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_projection));
+        //glUniformMatrix4fv(app.glsl_program[program_name + variant].uniforms["view_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_view));
+        glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_buildings));
+        if (lit) glUniformMatrix3fv(uniformLocation(program.uniforms, "normal_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat3_normal_buildings));
 
-        glUniform3fv(app.glsl_program[program_name].uniforms["material_color"], 1, glm::value_ptr(mat.color));
-        if (program_name != "nolight_col") glUniform3fv(app.glsl_program[program_name].uniforms["material_specular"], 1, glm::value_ptr(mat.specular));
-        if (program_name != "nolight_col") glUniform1f(app.glsl_program[program_name].uniforms["material_shininess"], mat.shininess);
+        glUniform3fv(uniformLocation(program.uniforms, "material_color"), 1, glm::value_ptr(mat.color));
+        if (lit) glUniform3fv(uniformLocation(program.uniforms, "material_specular"), 1, glm::value_ptr(mat.specular));
+        if (lit) glUniform1f(uniformLocation(program.uniforms, "material_shininess"), mat.shininess);
 
         glBindVertexArray(models[i].vertex_array);
         glDrawElements(GL_PATCHES, models[i].face_index_count, GL_UNSIGNED_INT, 0);
@@ -548,55 +571,54 @@ void render(GLFWwindow *window, App &app)
     for (i = 0; i < models.size(); i++)
     {
         std::string program_name;
+        int variant = classifyModel(models[i], app.mat4_model_car, app);
         Material mat = app.car->getMaterial(models[i].material_name);
         if (models[i].material_name == "roller" || models[i].material_name == "rear_light")
         {
-            glUseProgram(app.glsl_program["nolight_tex"].program);
             program_name = "nolight_tex";
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mat.texture_id);
-            glUniform1i(app.glsl_program[program_name].uniforms["image"], 0);
         }
         else if (mat.has_texture){
-            glUseProgram(app.glsl_program["texture"].program);
             program_name = "texture";
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mat.texture_id);
-            glUniform1i(app.glsl_program[program_name].uniforms["image"], 0);
         }
         else
         {
-            glUseProgram(app.glsl_program["color"].program);
             program_name = "color";
         }
+        bool lit = program_name != "nolight_tex";
+        GlslProgram &program = useProgram(program_name, variant, lit ? app.num_lights : -1, lit ? app.num_spotlights : -1, app);
+
+        if (program_name != "color")
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, mat.texture_id);
+            glUniform1i(uniformLocation(program.uniforms, "image"), 0);
+        }
 
-        if (program_name != "nolight_tex")
+        if (lit)
         {
-            glUniform1i(app.glsl_program[program_name].uniforms["num_lights"], app.num_lights);
-            glUniform1i(app.glsl_program[program_name].uniforms["num_spotlights"], app.num_spotlights);
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_ambient"], 1, glm::value_ptr(app.light_ambient));
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_position[0]"], app.num_lights, app.light_position);
-            glUniform3fv(app.glsl_program[program_name].uniforms["light_color[0]"], app.num_lights, app.light_color);
-            glUniform2fv(app.glsl_program[program_name].uniforms["pointlight_attenuation"], 1, light_attenuation);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_position[0]"], app.num_spotlights, app.spotlight_position);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_direction[0]"], app.num_spotlights, app.spotlight_direction);
-            glUniform3fv(app.glsl_program[program_name].uniforms["spotlight_color[0]"], app.num_spotlights, app.spotlight_color);
-            glUniform2fv(app.glsl_program[program_name].uniforms["spotlight_attenuation[0]"], app.num_spotlights, app.spotlight_attenuation);
-            glUniform1fv(app.glsl_program[program_name].uniforms["spotlight_fov[0]"], app.num_spotlights, app.spotlight_fov);
+            glUniform1i(uniformLocation(program.uniforms, "num_lights"), app.num_lights);
+            glUniform1i(uniformLocation(program.uniforms, "num_spotlights"), app.num_spotlights);
+            glUniform3fv(uniformLocation(program.uniforms, "light_ambient"), 1, glm::value_ptr(app.light_ambient));
+            glUniform3fv(uniformLocation(program.uniforms, "light_position[0]"), app.num_lights, app.light_position);
+            glUniform3fv(uniformLocation(program.uniforms, "light_color[0]"), app.num_lights, app.light_color);
+            glUniform2fv(uniformLocation(program.uniforms, "pointlight_attenuation"), 1, light_attenuation);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_position[0]"), app.num_spotlights, app.spotlight_position);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_direction[0]"), app.num_spotlights, app.spotlight_direction);
+            glUniform3fv(uniformLocation(program.uniforms, "spotlight_color[0]"), app.num_spotlights, app.spotlight_color);
+            glUniform2fv(uniformLocation(program.uniforms, "spotlight_attenuation[0]"), app.num_spotlights, app.spotlight_attenuation);
+            glUniform1fv(uniformLocation(program.uniforms, "spotlight_fov[0]"), app.num_spotlights, app.spotlight_fov);
         }
-        glUniform3fv(app.glsl_program[program_name].uniforms["camera_position"], 1, glm::value_ptr(app.camera_position));
-        glUniform1f(app.glsl_program[program_name].uniforms["camera_offset"], app.camera_offset);
+        glUniform3fv(uniformLocation(program.uniforms, "camera_position"), 1, glm::value_ptr(app.camera_position));
+        glUniform1f(uniformLocation(program.uniforms, "camera_offset"), app.camera_offset);
 
-        //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["projection_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_projection));
-        //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["view_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_view));
-        glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_car));
-        if (program_name != "nolight_tex") glUniformMatrix3fv(app.glsl_program[program_name].uniforms["normal_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat3_normal_car));
+        //glUniformMatrix4fv(app.glsl_program[program_name + variant].uniforms["projection_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_projection));
+        //glUniformMatrix4fv(app.glsl_program[program_name + variant].uniforms["view_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_view));
+        glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_car));
+        if (lit) glUniformMatrix3fv(uniformLocation(program.uniforms, "normal_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat3_normal_car));
 
-        if (program_name != "nolight_tex") glUniform3fv(app.glsl_program[program_name].uniforms["material_color"], 1, glm::value_ptr(mat.color));
-        if (program_name != "nolight_tex") glUniform3fv(app.glsl_program[program_name].uniforms["material_specular"], 1, glm::value_ptr(mat.specular));
-        if (program_name != "nolight_tex") glUniform1f(app.glsl_program[program_name].uniforms["material_shininess"], mat.shininess);
+        if (lit) glUniform3fv(uniformLocation(program.uniforms, "material_color"), 1, glm::value_ptr(mat.color));
+        if (lit) glUniform3fv(uniformLocation(program.uniforms, "material_specular"), 1, glm::value_ptr(mat.specular));
+        if (lit) glUniform1f(uniformLocation(program.uniforms, "material_shininess"), mat.shininess);
 
         glBindVertexArray(models[i].vertex_array);
         glDrawElements(GL_PATCHES, models[i].face_index_count, GL_UNSIGNED_INT, 0);
@@ -607,21 +629,20 @@ void render(GLFWwindow *window, App &app)
     models = app.skybox->getModelList();
     for (i = 0; i < models.size(); i++)
     {
-        std::string program_name = "nolight_tex";
-        glUseProgram(app.glsl_program[program_name].program);
+        GlslProgram &program = useProgram("nolight_tex", 0, -1, -1, app);
 
         Material mat = app.skybox->getMaterial(models[i].material_name);
         
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, mat.texture_id);
-        glUniform1i(app.glsl_program[program_name].uniforms["image"], 0);
+        glUniform1i(uniformLocation(program.uniforms, "image"), 0);
 
-        glUniform3fv(app.glsl_program[program_name].uniforms["camera_position"], 1, glm::value_ptr(app.camera_position));
-        glUniform1f(app.glsl_program[program_name].uniforms["camera_offset"], app.camera_offset);
+        glUniform3fv(uniformLocation(program.uniforms, "camera_position"), 1, glm::value_ptr(app.camera_position));
+        glUniform1f(uniformLocation(program.uniforms, "camera_offset"), app.camera_offset);
         
         //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["projection_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_projection));
         //glUniformMatrix4fv(app.glsl_program[program_name].uniforms["view_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_view));
-        glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_skybox));
+        glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_skybox));
         
         glBindVertexArray(models[i].vertex_array);
         glDrawElements(GL_PATCHES, models[i].face_index_count, GL_UNSIGNED_INT, 0);
@@ -629,8 +650,7 @@ void render(GLFWwindow *window, App &app)
     }
 
     // Draw targets
-    std::string program_name = "color";
-    glUseProgram(app.glsl_program[program_name].program);
+    GlslProgram &program = useProgram("color", 0, 2, 0, app);
 
     GLfloat target_red[3] = {0.959, 0.100, 0.050};
     GLfloat target_green[3] = {0.150, 0.750, 0.200};
@@ -639,33 +659,33 @@ void render(GLFWwindow *window, App &app)
     GLfloat target_light_color[6] = {0.8, 0.8, 0.8, 0.4, 0.4, 0.4};
     GLfloat target_light_attenuation[2] = {10.0, 50.0};
 
-    glUniform1i(app.glsl_program[program_name].uniforms["num_lights"], 2);
-    glUniform1i(app.glsl_program[program_name].uniforms["num_spotlights"], 0);
-    glUniform3fv(app.glsl_program[program_name].uniforms["light_ambient"], 1, glm::value_ptr(app.light_ambient));
-    glUniform3fv(app.glsl_program[program_name].uniforms["light_position[0]"], 2, target_light_position);
-    glUniform3fv(app.glsl_program[program_name].uniforms["light_color[0]"], 2, target_light_color);
-    glUniform2fv(app.glsl_program[program_name].uniforms["pointlight_attenuation"], 1, target_light_attenuation);
-    glUniform3fv(app.glsl_program[program_name].uniforms["camera_position"], 1, glm::value_ptr(app.camera_position));
-    glUniform1f(app.glsl_program[program_name].uniforms["camera_offset"], app.camera_offset);
+    glUniform1i(uniformLocation(program.uniforms, "num_lights"), 2);
+    glUniform1i(uniformLocation(program.uniforms, "num_spotlights"), 0);
+    glUniform3fv(uniformLocation(program.uniforms, "light_ambient"), 1, glm::value_ptr(app.light_ambient));
+    glUniform3fv(uniformLocation(program.uniforms, "light_position[0]"), 2, target_light_position);
+    glUniform3fv(uniformLocation(program.uniforms, "light_color[0]"), 2, target_light_color);
+    glUniform2fv(uniformLocation(program.uniforms, "pointlight_attenuation"), 1, target_light_attenuation);
+    glUniform3fv(uniformLocation(program.uniforms, "camera_position"), 1, glm::value_ptr(app.camera_position));
+    glUniform1f(uniformLocation(program.uniforms, "camera_offset"), app.camera_offset);
 
-    glUniformMatrix3fv(app.glsl_program[program_name].uniforms["normal_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat3_normal_target));
-    glUniform3fv(app.glsl_program[program_name].uniforms["material_color"], 1, target_red);
-    glUniform3fv(app.glsl_program[program_name].uniforms["material_specular"], 1, target_specular);
-    glUniform1f(app.glsl_program[program_name].uniforms["material_shininess"], 1.0f);
+    glUniformMatrix3fv(uniformLocation(program.uniforms, "normal_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat3_normal_target));
+    glUniform3fv(uniformLocation(program.uniforms, "material_color"), 1, target_red);
+    glUniform3fv(uniformLocation(program.uniforms, "material_specular"), 1, target_specular);
+    glUniform1f(uniformLocation(program.uniforms, "material_shininess"), 1.0f);
 
     glBindVertexArray(app.sphere_vertex_array);
 
-    glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_target1));
+    glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_target1));
     glDrawElements(GL_PATCHES, app.sphere_face_index_count, GL_UNSIGNED_SHORT, 0);
 
-    glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_target2));
+    glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_target2));
     glDrawElements(GL_PATCHES, app.sphere_face_index_count, GL_UNSIGNED_SHORT, 0);
 
-    glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_target3));
+    glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_target3));
     glDrawElements(GL_PATCHES, app.sphere_face_index_count, GL_UNSIGNED_SHORT, 0);
 
-    glUniformMatrix4fv(app.glsl_program[program_name].uniforms["model_matrix"], 1, GL_FALSE, glm::value_ptr(app.mat4_model_target4));
-    glUniform3fv(app.glsl_program[program_name].uniforms["material_color"], 1, target_green);
+    glUniformMatrix4fv(uniformLocation(program.uniforms, "model_matrix"), 1, GL_FALSE, glm::value_ptr(app.mat4_model_target4));
+    glUniform3fv(uniformLocation(program.uniforms, "material_color"), 1, target_green);
     glDrawElements(GL_PATCHES, app.sphere_face_index_count, GL_UNSIGNED_SHORT, 0);
 
     glBindVertexArray(0);
@@ -764,7 +784,67 @@ void saveImage(const char *filename, App &app)
     delete[] pixels;
 }
 
-void loadShader(std::string key, std::string shader_filename_base, App &app)
+GlslProgram& useProgram(std::string name, int variant, int num_lights, int num_spotlights, App &app)
+{
+    // geometry shader variant omits pole and/or seam handling, light counts (-1 for unlit programs)
+    // and a mono camera are baked in so the shader loops and offsets can be unrolled / folded away
+    std::vector<std::string> defines;
+    std::string key = name;
+    if (variant & VARIANT_NO_POLE) defines.push_back("NO_POLE");
+    if (variant & VARIANT_NO_SEAM) defines.push_back("NO_SEAM");
+    if (num_lights >= 0) defines.push_back("NUM_LIGHTS " + std::to_string(num_lights));
+    if (num_spotlights >= 0) defines.push_back("NUM_SPOTLIGHTS " + std::to_string(num_spotlights));
+    if (app.camera_offset == 0.0f) defines.push_back("MONO");
+    size_t i;
+    for (i = 0; i < defines.size(); i++)
+    {
+        key += "|" + defines[i];
+    }
+
+    // compile permutation the first time it is requested
+    if (app.glsl_program.find(key) == app.glsl_program.end())
+    {
+        loadShader(key, "resrc/shaders/equirect/" + name + "_equirect", app, defines);
+        std::cout << "Compiled shader permutation: " << key << std::endl;
+    }
+
+    GlslProgram &program = app.glsl_program[key];
+    glUseProgram(program.program);
+    return program;
+}
+
+GLint uniformLocation(std::map<std::string, GLint> &uniforms, std::string name)
+{
+    // uniforms a permutation does not use are not in the map (-1 makes `glUniform*` a no-op)
+    std::map<std::string, GLint>::iterator it = uniforms.find(name);
+    return (it != uniforms.end()) ? it->second : -1;
+}
+
+int classifyModel(Model &model, glm::mat4 &model_matrix, App &app)
+{
+    // world space bounding sphere (eye positions lie within `camera_offset` of the camera horizontally)
+    glm::vec3 center = glm::vec3(model_matrix * glm::vec4(model.center, 1.0));
+    float scale = std::max(glm::length(glm::vec3(model_matrix[0])), std::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2]))));
+    float margin = scale * model.radius + fabs(app.camera_offset);
+    float dx = center.x - app.camera_position.x;
+    float dz = center.z - app.camera_position.z;
+    int variant = 0;
+
+    // pole axis is the vertical line through the camera
+    if (dx * dx + dz * dz > margin * margin)
+    {
+        variant |= VARIANT_NO_POLE;
+
+        // seam is the vertical half-plane behind the camera (x = 0, z < 0 relative to the camera)
+        if (fabs(dx) > margin || dz > margin)
+        {
+            variant |= VARIANT_NO_SEAM;
+        }
+    }
+    return variant;
+}
+
+void loadShader(std::string key, std::string shader_filename_base, App &app, std::vector<std::string> defines)
 {
     // Read vertex and fragment shaders from file
     char *vert_source, *frag_source, *tesc_source, *tese_source, *geom_source;
@@ -779,16 +859,23 @@ void loadShader(std::string key, std::string shader_filename_base, App &app)
     int32_t geom_length = readFile(geom_filename.c_str(), &geom_source);
     int32_t frag_length = readFile(frag_filename.c_str(), &frag_source);
 
+    // Add `#define`s for shader variants
+    std::string vert_text = injectDefines(vert_source, vert_length, defines);
+    std::string tesc_text = injectDefines(tesc_source, tesc_length, defines);
+    std::string tese_text = injectDefines(tese_source, tese_length, defines);
+    std::string geom_text = injectDefines(geom_source, geom_length, defines);
+    std::string frag_text = injectDefines(frag_source, frag_length, defines);
+
     // Compile vetex shader
-    GLuint vertex_shader = compileShader(vert_source, vert_length, GL_VERTEX_SHADER);
+    GLuint vertex_shader = compileShader(&vert_text[0], vert_text.length(), GL_VERTEX_SHADER);
     // Compile tessellation control shader
-    GLuint tess_ctrl_shader = compileShader(tesc_source, tesc_length, GL_TESS_CONTROL_SHADER);
+    GLuint tess_ctrl_shader = compileShader(&tesc_text[0], tesc_text.length(), GL_TESS_CONTROL_SHADER);
     // Compile tessellation evaluation shader
-    GLuint tess_eval_shader = compileShader(tese_source, tese_length, GL_TESS_EVALUATION_SHADER);
+    GLuint tess_eval_shader = compileShader(&tese_text[0], tese_text.length(), GL_TESS_EVALUATION_SHADER);
     // Compile geometry shader
-    GLuint geometry_shader = compileShader(geom_source, geom_length, GL_GEOMETRY_SHADER);
+    GLuint geometry_shader = compileShader(&geom_text[0], geom_text.length(), GL_GEOMETRY_SHADER);
     // Compile fragment shader
-    GLuint fragment_shader = compileShader(frag_source, frag_length, GL_FRAGMENT_SHADER);
+    GLuint fragment_shader = compileShader(&frag_text[0], frag_text.length(), GL_FRAGMENT_SHADER);
 
     // Create GPU program from the compiled vertex and fragment shaders
     GLuint shaders[5] = {vertex_shader, tess_ctrl_shader, tess_eval_shader, geometry_shader, fragment_shader};
@@ -819,9 +906,34 @@ void loadShader(std::string key, std::string shader_filename_base, App &app)
         p.uniforms[uniform_name] = glGetUniformLocation(p.program, uniform_name);
     }
 
+    // tessellation targets a maximum edge length in output pixels
+    glUseProgram(p.program);
+    glUniform2f(uniformLocation(p.uniforms, "framebuffer_size"), app.framebuffer_width, app.framebuffer_height);
+    glUniform1f(uniformLocation(p.uniforms, "tess_edge_pixels"), app.tess_edge_pixels);
+    glUseProgram(0);
+
     app.glsl_program[key] = p;
 }
 
+std::string injectDefines(const char *source, int32_t length, std::vector<std::string> &defines)
+{
+    // `#define`s must follow the `#version` line
+    std::string text(source, length);
+    size_t insert_pos = 0;
+    size_t version_pos = text.find("#version");
+    if (version_pos != std::string::npos)
+    {
+        insert_pos = text.find('\n', version_pos);
+        insert_pos = (insert_pos == std::string::npos) ? text.length() : insert_pos + 1;
+    }
+    size_t i;
+    for (i = defines.size(); i > 0; i--)
+    {
+        text.insert(insert_pos, "#define " + defines[i - 1] + "\n");
+    }
+    return text;
+}
+
 GLint compileShader(char *source, int32_t length, GLenum type)
 {
     // Create a shader object
@@ -946,6 +1058,17 @@ int32_t readFile(const char* filename, char** data_ptr)
     return fsize;
 }
 
+glm::mat4 buildingsModelMatrix(glm::vec3 center, glm::vec3 size)
+{
+    float scale_factor = 1.0f / (std::max(size.x, std::max(size.y, size.z)));
+    glm::vec3 location = (-1.0f * center) + glm::vec3(0.0f, size.y / 2.0f, 1.0f);
+
+    glm::mat4 model_matrix = glm::scale(glm::mat4(1.0), glm::vec3(scale_factor, scale_factor, scale_factor));
+    model_matrix = glm::scale(model_matrix, glm::vec3(75.0, 75.0, 75.0));
+    model_matrix = glm::translate(model_matrix, location);
+    return model_matrix;
+}
+
 GLuint createSphereVao(GLuint position_attrib, GLuint normal_attrib, GLuint texcoord_attrib, GLuint *face_index_count)
 {
     // Create a new Vertex Array Object
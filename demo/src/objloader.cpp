@@ -1,10 +1,11 @@
 #include "objloader.h"
 
-ObjLoader::ObjLoader(const char *filename)
+ObjLoader::ObjLoader(const char *filename, SplitRegion *split_region)
 {
     _position_attrib = 0;
     _normal_attrib = 1;
     _texcoord_attrib = 2;
+    _split_region = split_region;
 
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> normals;
@@ -172,6 +173,11 @@ void ObjLoader::createModels(std::vector<glm::vec3> &vertices,
                              std::vector<glm::vec2> &texcoords,
                              std::vector<Group> &groups)
 {
+    if (_split_region != NULL)
+    {
+        splitFaces(vertices, normals, texcoords, groups);
+    }
+
     int i, j, k;
     int face_count = 0;
     for (i = 0; i < groups.size(); i++)
@@ -188,6 +194,8 @@ void ObjLoader::createModels(std::vector<glm::vec3> &vertices,
         GLfloat *model_normals = new GLfloat[num_verts * 3];
         GLfloat *model_texcoords = new GLfloat[num_verts * 2];
         GLuint *model_indices = new GLuint[num_faces * 3];
+        glm::vec3 min_coord = glm::vec3(9.9e12, 9.9e12, 9.9e12);
+        glm::vec3 max_coord = glm::vec3(-9.9e12, -9.9e12, -9.9e12);
         
         for (j = 0; j < num_faces; j++)
         {
@@ -200,6 +208,8 @@ void ObjLoader::createModels(std::vector<glm::vec3> &vertices,
                 model_vertices[vn_idx] = vertex.x;
                 model_vertices[vn_idx + 1] = vertex.y;
                 model_vertices[vn_idx + 2] = vertex.z;
+                min_coord = glm::min(min_coord, vertex);
+                max_coord = glm::max(max_coord, vertex);
 
                 glm::vec3 normal = normals[groups[i].faces[j].normal_indices[k]];
                 model_normals[vn_idx] = normal.x;
@@ -221,6 +231,10 @@ void ObjLoader::createModels(std::vector<glm::vec3> &vertices,
 
         model.face_index_count = num_faces * 3;
 
+        // bounding sphere (used to select shader variants)
+        model.center = 0.5f * (min_coord + max_coord);
+        model.radius = 0.5f * glm::length(max_coord - min_coord);
+
         // Create a new Vertex Array Object
         glGenVertexArrays(1, &(model.vertex_array));
         // Set newly created Vertex Array Object as the active one we are modifying
@@ -399,6 +413,179 @@ glm::vec3& ObjLoader::getSize()
     return _size;
 }
 
+void ObjLoader::splitFaces(std::vector<glm::vec3> &vertices,
+                           std::vector<glm::vec3> &normals,
+                           std::vector<glm::vec2> &texcoords,
+                           std::vector<Group> &groups)
+{
+    // Reference region is given in world space, so bring vertices into world space first
+    _split_model_matrix = _split_region->model_matrix(_center, _size);
+
+    int i, j, k;
+    int original_count = 0;
+    int split_count = 0;
+    float max_span_before = 0.0f;
+    float max_span_after = 0.0f;
+    for (i = 0; i < groups.size(); i++)
+    {
+        bool has_texture = _materials[groups[i].material_name].has_texture;
+        std::vector<Face> faces;
+        for (j = 0; j < groups[i].faces.size(); j++)
+        {
+            Face &face = groups[i].faces[j];
+            Corner corners[3];
+            for (k = 0; k < 3; k++)
+            {
+                corners[k].position = vertices[face.vertex_indices[k]];
+                corners[k].normal = normals[face.normal_indices[k]];
+                corners[k].texcoord = has_texture ? texcoords[face.texcoord_indices[k]] : glm::vec2(0.0f, 0.0f);
+                max_span_before = std::max(max_span_before, edgeSpan(vertices[face.vertex_indices[k]], vertices[face.vertex_indices[(k + 1) % 3]]));
+            }
+
+            std::vector<Corner> triangles;
+            splitTriangle(corners, triangles);
+            original_count++;
+
+            // Unchanged triangles keep their original indices
+            if (triangles.size() == 3)
+            {
+                faces.push_back(face);
+                for (k = 0; k < 3; k++)
+                {
+                    max_span_after = std::max(max_span_after, edgeSpan(triangles[k].position, triangles[(k + 1) % 3].position));
+                }
+                continue;
+            }
+
+            int t;
+            for (t = 0; t < triangles.size(); t += 3)
+            {
+                Face new_face;
+                for (k = 0; k < 3; k++)
+                {
+                    new_face.vertex_indices[k] = vertices.size();
+                    new_face.normal_indices[k] = normals.size();
+                    new_face.texcoord_indices[k] = texcoords.size();
+                    vertices.push_back(triangles[t + k].position);
+                    normals.push_back(triangles[t + k].normal);
+                    texcoords.push_back(triangles[t + k].texcoord);
+                    max_span_after = std::max(max_span_after, edgeSpan(triangles[t + k].position, triangles[t + (k + 1) % 3].position));
+                }
+                faces.push_back(new_face);
+            }
+            split_count++;
+        }
+        groups[i].faces = faces;
+    }
+
+    printf("OBJ: split %d of %d triangles (max edge span %.1f -> %.1f degrees)\n", split_count, original_count, max_span_before, max_span_after);
+}
+
+void ObjLoader::splitTriangle(Corner corners[3], std::vector<Corner> &triangles)
+{
+    // Whether an edge is split only depends on its end points, so triangles sharing an edge
+    // always agree and no T-junctions are introduced (recursion ends at `min_edge_length`)
+    bool split[3];
+    int k, num_split = 0;
+    for (k = 0; k < 3; k++)
+    {
+        split[k] = splitEdge(corners[k].position, corners[(k + 1) % 3].position);
+        if (split[k]) num_split++;
+    }
+
+    if (num_split == 0)
+    {
+        triangles.push_back(corners[0]);
+        triangles.push_back(corners[1]);
+        triangles.push_back(corners[2]);
+        return;
+    }
+
+    // Edge k connects corner k and corner k+1
+    Corner mid[3];
+    for (k = 0; k < 3; k++)
+    {
+        if (split[k]) mid[k] = midpoint(corners[k], corners[(k + 1) % 3]);
+    }
+
+    if (num_split == 3)
+    {
+        Corner t0[3] = {corners[0], mid[0], mid[2]};
+        Corner t1[3] = {mid[0], corners[1], mid[1]};
+        Corner t2[3] = {mid[2], mid[1], corners[2]};
+        Corner t3[3] = {mid[0], mid[1], mid[2]};
+        splitTriangle(t0, triangles);
+        splitTriangle(t1, triangles);
+        splitTriangle(t2, triangles);
+        splitTriangle(t3, triangles);
+    }
+    else if (num_split == 1)
+    {
+        // Rotate so that the split edge is edge 0
+        for (k = 0; !split[k]; k++);
+        Corner c0 = corners[k], c1 = corners[(k + 1) % 3], c2 = corners[(k + 2) % 3];
+        Corner t0[3] = {c0, mid[k], c2};
+        Corner t1[3] = {mid[k], c1, c2};
+        splitTriangle(t0, triangles);
+        splitTriangle(t1, triangles);
+    }
+    else
+    {
+        // Rotate so that edge 2 is the one left intact (edges 0 and 1 are split)
+        for (k = 0; split[(k + 2) % 3]; k++);
+        Corner c0 = corners[k], c1 = corners[(k + 1) % 3], c2 = corners[(k + 2) % 3];
+        Corner m01 = mid[k], m12 = mid[(k + 1) % 3];
+        Corner t0[3] = {m01, c1, m12};
+        Corner t1[3] = {c0, m01, m12};
+        Corner t2[3] = {c0, m12, c2};
+        splitTriangle(t0, triangles);
+        splitTriangle(t1, triangles);
+        splitTriangle(t2, triangles);
+    }
+}
+
+bool ObjLoader::splitEdge(glm::vec3 &a, glm::vec3 &b)
+{
+    // Evaluate in a fixed end point order so both neighboring triangles get the same answer
+    if (a.x > b.x || (a.x == b.x && (a.y > b.y || (a.y == b.y && a.z > b.z))))
+    {
+        return splitEdge(b, a);
+    }
+
+    glm::vec3 world_a = glm::vec3(_split_model_matrix * glm::vec4(a, 1.0f));
+    glm::vec3 world_b = glm::vec3(_split_model_matrix * glm::vec4(b, 1.0f));
+    if (glm::length(world_b - world_a) < _split_region->min_edge_length)
+    {
+        return false;
+    }
+    return edgeSpan(a, b) > _split_region->max_span;
+}
+
+float ObjLoader::edgeSpan(glm::vec3 &a, glm::vec3 &b)
+{
+    // Conservative angle subtended by the edge from any point in the viewing sphere:
+    // chord length over the closest approach (clamped to 180 degrees)
+    glm::vec3 world_a = glm::vec3(_split_model_matrix * glm::vec4(a, 1.0f));
+    glm::vec3 world_b = glm::vec3(_split_model_matrix * glm::vec4(b, 1.0f));
+    glm::vec3 edge = world_b - world_a;
+    float t = glm::clamp(glm::dot(_split_region->center - world_a, edge) / std::max(glm::dot(edge, edge), 1.0e-12f), 0.0f, 1.0f);
+    float closest = glm::length(world_a + t * edge - _split_region->center) - _split_region->radius;
+    if (closest <= 0.0f)
+    {
+        return 180.0f;
+    }
+    return std::min(glm::degrees(2.0f * atan(0.5f * glm::length(edge) / closest)), 180.0f);
+}
+
+Corner ObjLoader::midpoint(Corner &a, Corner &b)
+{
+    Corner mid;
+    mid.position = 0.5f * (a.position + b.position);
+    mid.normal = glm::normalize(a.normal + b.normal);
+    mid.texcoord = 0.5f * (a.texcoord + b.texcoord);
+    return mid;
+}
+
 int ObjLoader::findGroupByName(std::vector<Group> &groups, std::string material_name)
 {
     int i;
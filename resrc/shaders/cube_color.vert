@@ -0,0 +1,39 @@
+#version 410 core
+
+#define EPSILON 0.000001
+
+in vec3 vertex_position;
+in vec3 vertex_normal;
+in vec2 vertex_texcoord;
+in vec3 point_center;
+in vec3 point_color;
+in float point_size;
+
+uniform vec3 camera_position;
+uniform mat4 view_projection;
+
+out vec3 world_position;
+out vec3 world_normal;
+out vec2 model_texcoord;
+out vec3 model_color;
+out vec3 model_center;
+
+void main() {
+    // billboard faces the camera, oriented the same way as in the mono equirect pipeline
+    vec3 vertex_direction = normalize(point_center - camera_position);
+
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 right = cross(vertex_direction, up);
+    vec3 cam_right = (length(right) > EPSILON) ? normalize(right) : vec3(0.0, 0.0, 1.0);
+    vec3 cam_up = cross(cam_right, vertex_direction);
+
+    world_position = point_center + cam_right * vertex_position.x * point_size +
+                                    cam_up * vertex_position.y * point_size;
+    world_normal = -vertex_direction;
+    model_texcoord = vertex_texcoord;
+    model_color = point_color;
+    model_center = point_center;
+
+    // plain perspective projection into the current cube face
+    gl_Position = view_projection * vec4(world_position, 1.0);
+}
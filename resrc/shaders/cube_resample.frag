@@ -0,0 +1,18 @@
+#version 410 core
+
+#define M_PI 3.1415926535897932384626433832795
+
+in vec2 texcoord;
+
+uniform samplerCube cubemap;
+
+out vec4 FragColor;
+
+void main() {
+    // view direction of the equirect pixel (inverse of `projectVertex()` in equirect_color.geom)
+    float longitude = (2.0 * texcoord.x - 1.0) * M_PI;
+    float latitude = (texcoord.y - 0.5) * M_PI;
+    vec3 direction = vec3(-sin(longitude) * cos(latitude), sin(latitude), cos(longitude) * cos(latitude));
+
+    FragColor = texture(cubemap, direction);
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+out vec2 texcoord;
+
+void main() {
+    // single triangle that covers the whole viewport
+    vec2 position = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    texcoord = 0.5 * position + 0.5;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -3,25 +3,57 @@
 #define NEAR 0.01
 #define FAR 1000.0
 
+// compile-time specialization (defines injected by the application)
+#ifdef NUM_LIGHTS
+#define LIGHT_COUNT NUM_LIGHTS
+#else
+#define LIGHT_COUNT num_lights
+#endif
+#ifdef VIEWS
+#define camera_position view_camera_position[view]
+#define camera_offset view_camera_offset[view]
+#endif
+#if defined(MONO)
+#define CAMERA_OFFSET 0.0
+#elif defined(STEREO)
+#define CAMERA_OFFSET eye_offset
+#else
+#define CAMERA_OFFSET camera_offset
+#endif
+
 in vec3 world_position;
 in vec3 world_normal;
 in vec2 model_texcoord;
 in vec3 model_color;
 in vec3 model_center;
+#ifdef STEREO
+flat in float eye_offset;
+#endif
+#ifdef VIEWS
+flat in int view;
+#endif
 
 uniform float model_size;
 uniform int num_lights;
 uniform vec3 light_ambient;
 uniform vec3 light_position[10];
 uniform vec3 light_color[10];
+#ifdef VIEWS
+uniform vec3 view_camera_position[VIEWS];
+uniform float view_camera_offset[VIEWS];
+#else
 uniform vec3 camera_position;
 uniform float camera_offset;
+#endif
 uniform vec3 material_color;      // Ka and Kd
 //uniform vec3 material_specular;   // Ks
 //uniform float material_shininess; // n
 uniform sampler2D image;
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+#ifdef DISTANCE_OUTPUT
+layout(location = 1) out float FragDistance;
+#endif
 
 void main() {
     // BILLBOARD SPHERES
@@ -44,7 +76,7 @@ void main() {
     vec3 sphere_position = (sphere_normal * sphere_radius) + model_center;
 
     vec3 light_diffuse = vec3(0.0, 0.0, 0.0);
-    for(int i = 0; i < num_lights; i++) {
+    for(int i = 0; i < LIGHT_COUNT; i++) {
         //diffuse
         vec3 light_direction = normalize(light_position[i] - sphere_position);
         float n_dot_l = max(dot(sphere_normal, light_direction), 0.0);
@@ -57,8 +89,11 @@ void main() {
 
     vec3 up = vec3(0.0, 1.0, 0.0);
     vec3 cam_right = normalize(cross(sphere_position - camera_position, up));
-    vec3 cam = camera_position + (camera_offset * cam_right);
+    vec3 cam = camera_position + (CAMERA_OFFSET * cam_right);
     float distance = length(sphere_position - cam);
     
     gl_FragDepth = (distance - NEAR) / (FAR - NEAR);
+#ifdef DISTANCE_OUTPUT
+    FragDistance = distance;
+#endif
 }
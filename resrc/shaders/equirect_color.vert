@@ -1,7 +1,23 @@
 #version 410 core
 
+#define M_PI 3.1415926535897932384626433832795
 #define EPSILON 0.000001
 
+// compile-time specialization (defines injected by the application)
+// (in single-pass stereo both eyes share one billboard facing the center of projection)
+#if defined(MONO) || defined(STEREO)
+#define CAMERA_OFFSET 0.0
+#else
+#define CAMERA_OFFSET camera_offset
+#endif
+// OUTPUT_BOUNDS - flag points that cannot reach the longitude / latitude bounds, the control shader drops them
+// VIEWS n - batch of n viewpoints, instance `i` draws point `i / n` for view `i % n` (the point attributes
+//           advance once per n instances), the view's camera replaces `camera_position` / `camera_offset`
+#ifdef VIEWS
+#define camera_position view_camera_position[view]
+#define camera_offset view_camera_offset[view]
+#endif
+
 in vec3 vertex_position;
 in vec3 vertex_normal;
 in vec2 vertex_texcoord;
@@ -11,21 +27,41 @@ in float point_size;
 
 //uniform vec3 model_center;
 //uniform float model_size;
+#ifdef VIEWS
+uniform vec3 view_camera_position[VIEWS];
+uniform float view_camera_offset[VIEWS];
+#else
 uniform vec3 camera_position;
 uniform float camera_offset;
+#endif
+#ifdef OUTPUT_BOUNDS
+uniform vec4 output_bounds; // left, right, bottom, top (radians)
+#endif
 
 out vec3 world_position_vert;
 out vec3 world_normal_vert;
 out vec2 model_texcoord_vert;
 out vec3 model_color_vert;
 out vec3 model_center_vert;
+#ifdef OUTPUT_BOUNDS
+out float outside_bounds_vert;
+#endif
+#ifdef VIEWS
+flat out int view_vert;
+
+int view;
+#endif
 
 void main() {
+#ifdef VIEWS
+    view = gl_InstanceID % VIEWS;
+    view_vert = view;
+#endif
     vec3 vertex_direction = normalize(point_center - camera_position);
 
     vec3 up = vec3(0.0, 1.0, 0.0);
     vec3 right = cross(vertex_direction, up);
-    vec3 offset = (length(right) > EPSILON) ? camera_offset * normalize(right) : vec3(0.0, 0.0, camera_offset);
+    vec3 offset = (length(right) > EPSILON) ? CAMERA_OFFSET * normalize(right) : vec3(0.0, 0.0, CAMERA_OFFSET);
     vec3 cam = camera_position + offset;
 
     vertex_direction = normalize(point_center - cam);
@@ -40,6 +76,24 @@ void main() {
     model_color_vert = point_color;
     model_center_vert = point_center;
 
+#ifdef OUTPUT_BOUNDS
+    // angular radius of the billboard (quad half diagonal) as seen from any eye position
+    vec3 center_direction = point_center - camera_position;
+    float center_distance = length(center_direction);
+    float angular_radius = asin(min((0.7072 * point_size + abs(camera_offset)) / max(center_distance, 1.0e-6), 1.0));
+    float center_latitude = asin(center_direction.y / max(center_distance, 1.0e-6));
+    float center_longitude = -atan(center_direction.x, center_direction.z);
+
+    bool outside = (center_latitude - angular_radius > output_bounds.w) || (center_latitude + angular_radius < output_bounds.z);
+    if (abs(center_latitude) + angular_radius < 0.5 * M_PI) {
+        // longitude extent of a circle grows towards the poles, only test away from them
+        float longitude_radius = asin(min(sin(angular_radius) / cos(center_latitude), 1.0));
+        float delta = center_longitude - 0.5 * (output_bounds.x + output_bounds.y);
+        delta = abs(delta - 2.0 * M_PI * floor((delta + M_PI) / (2.0 * M_PI)));
+        outside = outside || (delta - longitude_radius > 0.5 * (output_bounds.y - output_bounds.x));
+    }
+    outside_bounds_vert = outside ? 1.0 : 0.0;
+#endif
 
     //world_position_vert = (model_size * vertex_position) + point_center;
     //world_normal_vert = vertex_normal;
@@ -0,0 +1,24 @@
+#version 410 core
+
+// vertices captured from equirect_color.geom with transform feedback
+layout(location = 0) in vec4 captured_position;
+layout(location = 1) in vec3 captured_world_position;
+layout(location = 2) in vec3 captured_world_normal;
+layout(location = 3) in vec2 captured_model_texcoord;
+layout(location = 4) in vec3 captured_model_color;
+layout(location = 5) in vec3 captured_model_center;
+
+out vec3 world_position;
+out vec3 world_normal;
+out vec2 model_texcoord;
+out vec3 model_color;
+out vec3 model_center;
+
+void main() {
+    world_position = captured_world_position;
+    world_normal = captured_world_normal;
+    model_texcoord = captured_model_texcoord;
+    model_color = captured_model_color;
+    model_center = captured_model_center;
+    gl_Position = captured_position;
+}
@@ -0,0 +1,51 @@
+#version 410 core
+
+in vec2 texcoord;
+
+uniform sampler2D image;
+uniform sampler2D image_depth;
+uniform int max_fill_distance;
+
+out vec4 FragColor;
+
+void main() {
+    ivec2 size = textureSize(image, 0);
+    ivec2 px = min(ivec2(texcoord * vec2(size)), size - 1);
+    vec4 color = texelFetch(image, px, 0);
+    if (color.a > 0.0) {
+        FragColor = vec4(color.rgb, 1.0);
+        return;
+    }
+
+    // disoccluded pixel - use the nearest covered pixel along the row that lies further away
+    // (the hole shows background that was hidden behind the foreground edge)
+    int i;
+    bool found_left = false;
+    bool found_right = false;
+    float fill_depth = -1.0;
+    vec3 fill_color = color.rgb;
+    for (i = 1; i <= max_fill_distance && !(found_left && found_right); i++) {
+        ivec2 left = ivec2((px.x - i + size.x) % size.x, px.y);
+        ivec2 right = ivec2((px.x + i) % size.x, px.y);
+        vec4 left_color = texelFetch(image, left, 0);
+        vec4 right_color = texelFetch(image, right, 0);
+        if (!found_left && left_color.a > 0.0) {
+            found_left = true;
+            float depth = texelFetch(image_depth, left, 0).r;
+            if (depth > fill_depth) {
+                fill_depth = depth;
+                fill_color = left_color.rgb;
+            }
+        }
+        if (!found_right && right_color.a > 0.0) {
+            found_right = true;
+            float depth = texelFetch(image_depth, right, 0).r;
+            if (depth > fill_depth) {
+                fill_depth = depth;
+                fill_color = right_color.rgb;
+            }
+        }
+    }
+
+    FragColor = vec4(fill_color, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 410 core
+
+in vec2 source_texcoord_vert;
+
+uniform sampler2D source_color;
+
+out vec4 FragColor;
+
+void main() {
+    // single pixel splat - keeps objects too small to form an unbroken triangle after warping
+    FragColor = vec4(texture(source_color, source_texcoord_vert).rgb, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 410 core
+
+in vec2 source_texcoord;
+
+uniform sampler2D source_color;
+
+out vec4 FragColor;
+
+void main() {
+    // alpha marks covered pixels (holes keep the alpha 0 clear color)
+    FragColor = vec4(texture(source_color, source_texcoord).rgb, 1.0);
+}
@@ -0,0 +1,68 @@
+#version 410 core
+
+#define M_PI 3.1415926535897932384626433832795
+#define EPSILON 0.000001
+#define NEAR 0.01
+#define FAR 1000.0
+
+uniform sampler2D source_depth;
+uniform ivec2 image_size;
+uniform int vertices_per_pixel;
+uniform vec3 camera_position;
+uniform float source_offset;
+uniform float target_offset;
+
+out vec3 warped_position_vert;
+out vec2 source_texcoord_vert;
+out float source_distance_vert;
+
+vec3 eyePosition(vec3 position, float offset);
+
+void main() {
+    // points: one vertex per pixel of row `gl_InstanceID`
+    // triangles: one strip per row, even vertices on row `gl_InstanceID` and odd vertices on the row above
+    ivec2 pixel = ivec2(gl_VertexID / vertices_per_pixel, gl_InstanceID + (gl_VertexID % vertices_per_pixel));
+    float depth = texelFetch(source_depth, pixel, 0).r;
+    float distance = depth * (FAR - NEAR) + NEAR;
+
+    // view ray of the pixel center
+    vec2 texcoord = (vec2(pixel) + 0.5) / vec2(image_size);
+    float longitude = (2.0 * texcoord.x - 1.0) * M_PI;
+    float latitude = (texcoord.y - 0.5) * M_PI;
+    vec3 ray = vec3(-sin(longitude) * cos(latitude), sin(latitude), cos(longitude) * cos(latitude));
+
+    // eye position depends on the point being looked at - start at the center of projection and refine
+    int i;
+    vec3 position = camera_position + distance * ray;
+    for (i = 0; i < 3; i++) {
+        position = eyePosition(position, source_offset) + distance * ray;
+    }
+
+    // project into the other eye
+    vec3 vertex_direction = position - eyePosition(position, target_offset);
+    float magnitude = length(vertex_direction);
+    float target_longitude = (abs(vertex_direction.z) < EPSILON) ? sign(vertex_direction.x) * -M_PI * 0.5 : -atan(vertex_direction.x, vertex_direction.z);
+    float target_latitude = asin(vertex_direction.y / magnitude);
+    float target_depth = min((magnitude - NEAR) / (FAR - NEAR), 1.0);
+
+    warped_position_vert = vec3(target_longitude / M_PI, target_latitude / (0.5 * M_PI), 2.0 * target_depth - 1.0);
+    source_texcoord_vert = texcoord;
+    source_distance_vert = distance;
+    gl_Position = vec4(warped_position_vert, 1.0);
+}
+
+vec3 eyePosition(vec3 position, float offset) {
+    // same ocular offset model as `projectVertex()` in equirect_color.geom (including the falloff near the poles)
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 dir = position - camera_position;
+    vec3 right = cross(dir, up);
+
+    float inclination = abs(asin(dir.y / length(dir))) / M_PI;
+    float adjust_start = 0.5 - (1.0 / 12.0); // 15 degrees from pole
+    float adjust_end = 0.5; // at the pole
+    float adjust_coeff = clamp((inclination - adjust_start) / (adjust_end - adjust_start), 0.0, 1.0);
+    float adjusted_offset = (1.0 - adjust_coeff) * offset;
+
+    vec3 eye_offset = (length(right) > EPSILON) ? adjusted_offset * normalize(right) : vec3(0.0, 0.0, 0.0);
+    return camera_position + eye_offset;
+}
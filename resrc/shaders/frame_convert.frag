@@ -0,0 +1,58 @@
+#version 410 core
+
+// Saved image in its delivery layout: rows top-down with layers stacked, either as RGBA or as planar I420
+// packed row by row into a single channel target of the same width (`image_height` * 3 / 2 rows)
+
+#ifdef LAYERED
+uniform sampler2DArray image;
+#else
+uniform sampler2D image;
+#endif
+uniform int image_width;
+uniform int image_height;
+uniform int layer_height;
+
+out vec4 FragColor;
+
+vec3 fetchColor(int x, int row) {
+    // `row` counts top-down over all layers, OpenGL rows bottom-up within a layer
+    int y = layer_height - 1 - (row % layer_height);
+#ifdef LAYERED
+    return texelFetch(image, ivec3(x, y, row / layer_height), 0).rgb;
+#else
+    return texelFetch(image, ivec2(x, y), 0).rgb;
+#endif
+}
+
+ivec3 fetchPixel(int x, int row) {
+    return ivec3(fetchColor(x, row) * 255.0 + 0.5);
+}
+
+void main() {
+    // readback returns target rows bottom-up, so target row 0 holds the first row of the file
+    int x = int(gl_FragCoord.x);
+#ifdef YUV420
+    int offset = int(gl_FragCoord.y) * image_width + x;
+    int luma_size = image_width * image_height;
+    int value;
+    if (offset < luma_size) {
+        // same integer BT.601 limited range conversion as the writer threads
+        ivec3 c = fetchPixel(offset % image_width, offset / image_width);
+        value = ((66 * c.r + 129 * c.g + 25 * c.b + 128) >> 8) + 16;
+    } else {
+        // U plane then V plane, each from the rounded average of a 2x2 block
+        int chroma_width = image_width / 2;
+        int chroma_size = chroma_width * (image_height / 2);
+        offset -= luma_size;
+        bool v_plane = offset >= chroma_size;
+        offset -= v_plane ? chroma_size : 0;
+        int cx = 2 * (offset % chroma_width);
+        int cy = 2 * (offset / chroma_width);
+        ivec3 c = (fetchPixel(cx, cy) + fetchPixel(cx + 1, cy) + fetchPixel(cx, cy + 1) + fetchPixel(cx + 1, cy + 1) + 2) >> 2;
+        value = v_plane ? ((112 * c.r - 94 * c.g - 18 * c.b + 128) >> 8) + 128 : ((-38 * c.r - 74 * c.g + 112 * c.b + 128) >> 8) + 128;
+    }
+    FragColor = vec4(float(value) / 255.0);
+#else
+    FragColor = vec4(fetchColor(x, int(gl_FragCoord.y)), 1.0);
+#endif
+}
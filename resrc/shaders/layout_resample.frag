@@ -0,0 +1,15 @@
+#version 410 core
+
+#define M_PI 3.1415926535897932384626433832795
+
+in vec2 texcoord;
+
+uniform sampler2D layout_image;
+
+out vec4 FragColor;
+
+void main() {
+    // equal-area layout rows are spaced by sin(latitude), columns match the equirect output
+    float latitude = (texcoord.y - 0.5) * M_PI;
+    FragColor = texture(layout_image, vec2(texcoord.x, 0.5 * sin(latitude) + 0.5));
+}
@@ -0,0 +1,36 @@
+#version 410 core
+
+#define M_PI 3.1415926535897932384626433832795
+#define MAX_SLICE_ROWS 16
+
+in vec2 texcoord;
+
+uniform sampler2DArray slices;
+uniform int slice_columns;
+uniform int slice_rows;
+uniform vec4 row_bounds[MAX_SLICE_ROWS]; // left, right, bottom, top tangents of each row's frustum
+
+out vec4 FragColor;
+
+void main() {
+    // view direction of the equirect pixel (inverse of `projectVertex()` in equirect_color.geom)
+    float longitude = (2.0 * texcoord.x - 1.0) * M_PI;
+    float latitude = (texcoord.y - 0.5) * M_PI;
+    vec3 direction = vec3(-sin(longitude) * cos(latitude), sin(latitude), cos(longitude) * cos(latitude));
+
+    // slice covering this pixel - columns split the longitude range, rows the latitude range
+    int column = clamp(int(texcoord.x * float(slice_columns)), 0, slice_columns - 1);
+    int row = clamp(int(texcoord.y * float(slice_rows)), 0, slice_rows - 1);
+    float center_longitude = (2.0 * (float(column) + 0.5) / float(slice_columns) - 1.0) * M_PI;
+    float center_latitude = ((float(row) + 0.5) / float(slice_rows) - 0.5) * M_PI;
+
+    // project direction into the slice camera (same basis as glm::lookAt with +y up)
+    vec3 forward = vec3(-sin(center_longitude) * cos(center_latitude), sin(center_latitude), cos(center_longitude) * cos(center_latitude));
+    vec3 right = normalize(cross(forward, vec3(0.0, 1.0, 0.0)));
+    vec3 up = cross(right, forward);
+    vec2 tangent = vec2(dot(direction, right), dot(direction, up)) / dot(direction, forward);
+    vec4 bounds = row_bounds[row];
+    vec2 slice_texcoord = (tangent - bounds.xz) / (bounds.yw - bounds.xz);
+
+    FragColor = texture(slices, vec3(slice_texcoord, float(column * slice_rows + row)));
+}
@@ -0,0 +1,21 @@
+#version 430 core
+
+layout(r32ui, binding = 0) uniform uimage2D depth_image;
+layout(rgba8, binding = 1) uniform image2D color_image;
+
+out vec4 FragColor;
+
+void main() {
+    ivec2 px = ivec2(gl_FragCoord.xy);
+    uint distance_bits = imageLoad(depth_image, px).r;
+
+    // reset nearest distance for next frame
+    imageStore(depth_image, px, uvec4(0xFFFFFFFFu));
+
+    // no point covers this pixel - keep clear color
+    if (distance_bits == 0xFFFFFFFFu) {
+        discard;
+    }
+
+    FragColor = imageLoad(color_image, px);
+}
@@ -0,0 +1,7 @@
+#version 430 core
+
+void main() {
+    // single triangle that covers the whole viewport
+    vec2 position = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 410 core
+
+// One level of the output pyramid: [1 3 3 1] tent filter over 4x4 texels of the level above, averaged in
+// linear light. Taps wrap around the longitude seam and continue over the poles on the opposite meridian.
+
+uniform sampler2D source;
+uniform ivec2 source_size;
+
+out vec4 FragColor;
+
+vec3 fetchLinear(int x, int y) {
+    // rows are bottom-up: south pole below row 0, north pole above the last row
+    if (y < 0) {
+        y = -1 - y;
+        x += source_size.x / 2;
+    } else if (y >= source_size.y) {
+        y = 2 * source_size.y - 1 - y;
+        x += source_size.x / 2;
+    }
+    // (taps reach at most one texel left of the seam, and `%` is undefined for negative operands)
+    x = (x + source_size.x) % source_size.x;
+    vec3 color = texelFetch(source, ivec2(x, y), 0).rgb;
+    return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+void main() {
+    const float weights[4] = float[](1.0, 3.0, 3.0, 1.0);
+    ivec2 corner = 2 * ivec2(gl_FragCoord.xy) - 1;
+    vec3 sum = vec3(0.0);
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            sum += weights[i] * weights[j] * fetchLinear(corner.x + i, corner.y + j);
+        }
+    }
+    vec3 color = sum / 64.0;
+    FragColor = vec4(mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308))), 1.0);
+}
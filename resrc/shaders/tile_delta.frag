@@ -0,0 +1,34 @@
+#version 410 core
+
+// One texel per output tile: 1 if any pixel of the tile differs from the previous saved frame. Target row 0
+// is the top row of tiles, since readback returns target rows bottom-up.
+
+uniform sampler2D image;
+uniform sampler2D reference;
+uniform int tile_size;
+uniform bool reference_valid;
+
+out vec4 FragColor;
+
+void main() {
+    if (!reference_valid) {
+        FragColor = vec4(1.0);
+        return;
+    }
+    ivec2 size = textureSize(image, 0);
+    ivec2 tile = ivec2(gl_FragCoord.xy) * tile_size;
+    int row_end = min(tile.y + tile_size, size.y);
+    int x_end = min(tile.x + tile_size, size.x);
+    float changed = 0.0;
+    for (int row = tile.y; row < row_end && changed == 0.0; row++) {
+        // `row` counts top-down, OpenGL rows bottom-up
+        int y = size.y - 1 - row;
+        for (int x = tile.x; x < x_end; x++) {
+            if (any(notEqual(texelFetch(image, ivec2(x, y), 0).rgb, texelFetch(reference, ivec2(x, y), 0).rgb))) {
+                changed = 1.0;
+                break;
+            }
+        }
+    }
+    FragColor = vec4(changed);
+}
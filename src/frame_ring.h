@@ -0,0 +1,67 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+// Layout of the POSIX shared memory ring that `omnistereo --shm-output <name>` publishes frames into.
+// The ring header fills the first page, followed by `num_slots` slots of `slot_size` bytes, each a slot
+// header and the pixels of one frame. Slots are reused oldest first and never wait for readers, a reader
+// checks the slot's sequence before and after using the pixels (odd while the slot is being written).
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define FRAME_RING_MAGIC            0x474e5246 // "FRNG"
+#define FRAME_RING_VERSION          2
+#define FRAME_RING_HEADER_SIZE      4096
+#define FRAME_RING_SLOT_HEADER_SIZE 64
+
+#define FRAME_RING_FORMAT_RGB       0
+#define FRAME_RING_FORMAT_BGRA      1
+
+#define FRAME_RING_EYE_MONO         0
+#define FRAME_RING_EYE_LEFT         1
+#define FRAME_RING_EYE_RIGHT        2
+#define FRAME_RING_EYE_STEREO       3 // left eye above the right one, or in the first of two layers
+
+typedef struct FrameRingHeader {
+    std::atomic<uint32_t> magic; // stored last, once the ring is ready
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t pixel_format;
+    uint32_t width;
+    uint32_t layer_height;
+    uint32_t num_layers; // layers are stacked, first layer first
+    uint32_t top_down; // 0: rows bottom-up within each layer (OpenGL order)
+    uint32_t eye;
+    uint32_t checksums; // 1 if slots carry a checksum of their pixels (`--shm-checksum 1`)
+    uint64_t frame_size; // pixel bytes of one frame
+    uint64_t slot_size;
+    std::atomic<uint64_t> latest; // sequence of the newest complete frame, 0 before the first
+    std::atomic<uint32_t> finished; // 1 once the producer has exited
+} FrameRingHeader;
+
+typedef struct FrameRingSlot {
+    std::atomic<uint64_t> sequence; // 2 * frame sequence when complete, odd while being written
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC when the frame was handed to readback
+    uint32_t checksum; // Adler-32 of the pixels, 0 without `checksums`
+    uint32_t eye;
+} FrameRingSlot;
+
+inline FrameRingSlot* frameRingSlot(uint8_t *ring, uint64_t sequence)
+{
+    // Frame `sequence` (counting from 1) lives in slot `(sequence - 1) % num_slots`
+    FrameRingHeader *header = (FrameRingHeader*)ring;
+    return (FrameRingSlot*)(ring + FRAME_RING_HEADER_SIZE + ((sequence - 1) % header->num_slots) * header->slot_size);
+}
+
+inline uint8_t* frameRingPixels(FrameRingSlot *slot)
+{
+    return (uint8_t*)slot + FRAME_RING_SLOT_HEADER_SIZE;
+}
+
+inline size_t frameRingSize(uint32_t num_slots, uint64_t slot_size)
+{
+    return FRAME_RING_HEADER_SIZE + (size_t)num_slots * slot_size;
+}
+
+#endif // FRAME_RING_H
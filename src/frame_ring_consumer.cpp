@@ -0,0 +1,125 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <atomic>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <zlib.h>
+#include "frame_ring.h"
+
+// Example reader of the shared memory frame ring: follows the newest frames in place (no copy), verifies each
+// against its checksum (when the producer computes them) and reports how long frames took from readback to the reader
+//   ./bin/frame_ring_consumer /omnistereo [frames]
+
+uint64_t monotonicNanoseconds();
+
+int main(int argc, char **argv)
+{
+    std::string name = (argc >= 2) ? argv[1] : "/omnistereo";
+    uint64_t max_frames = (argc >= 3) ? std::stoull(argv[2]) : 0;
+
+    // Wait for the producer to create, size and describe the ring
+    int fd = -1;
+    struct stat ring_stat;
+    while ((fd = shm_open(name.c_str(), O_RDONLY, 0)) < 0 || fstat(fd, &ring_stat) != 0 || ring_stat.st_size < FRAME_RING_HEADER_SIZE)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        usleep(10000);
+    }
+    FrameRingHeader *header = (FrameRingHeader*)mmap(NULL, FRAME_RING_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED)
+    {
+        std::cerr << "Error: cannot map shared memory " << name << std::endl;
+        exit(1);
+    }
+    while (header->magic.load(std::memory_order_acquire) != FRAME_RING_MAGIC)
+    {
+        usleep(1000);
+    }
+    if (header->version != FRAME_RING_VERSION)
+    {
+        std::cerr << "Error: frame ring version " << header->version << " (expected " << FRAME_RING_VERSION << ")" << std::endl;
+        exit(1);
+    }
+    size_t size = frameRingSize(header->num_slots, header->slot_size);
+    uint8_t *ring = (uint8_t*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    munmap(header, FRAME_RING_HEADER_SIZE);
+    if (ring == MAP_FAILED)
+    {
+        std::cerr << "Error: cannot map shared memory " << name << std::endl;
+        exit(1);
+    }
+    header = (FrameRingHeader*)ring;
+    printf("Reading %ux%u %s frames (%u layers, eye %u, rows %s, checksums %s) from %s (%u slots)\n", header->width,
+           header->layer_height * header->num_layers, (header->pixel_format == FRAME_RING_FORMAT_BGRA) ? "BGRA" : "RGB", header->num_layers,
+           header->eye, header->top_down ? "top-down" : "bottom-up", header->checksums ? "on" : "off", name.c_str(), header->num_slots);
+
+    // Follow the newest frame, frames overwritten before they were reached count as skipped
+    uint64_t last = 0;
+    uint64_t num_frames = 0, num_skipped = 0, num_torn = 0, num_corrupt = 0;
+    double latency_sum = 0.0, latency_max = 0.0;
+    while (max_frames == 0 || num_frames < max_frames)
+    {
+        uint64_t latest = header->latest.load(std::memory_order_acquire);
+        if (latest == last)
+        {
+            if (header->finished.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            usleep(200);
+            continue;
+        }
+        num_skipped += latest - last - 1;
+        last = latest;
+
+        FrameRingSlot *slot = frameRingSlot(ring, latest);
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * latest)
+        {
+            num_torn++;
+            continue;
+        }
+        double latency = (monotonicNanoseconds() - slot->timestamp_ns) / 1.0e6;
+        uint32_t checksum = slot->checksum;
+        uint32_t actual = header->checksums ? adler32(adler32(0L, Z_NULL, 0), frameRingPixels(slot), header->frame_size) : 0;
+        // the producer may have reused the slot while it was being checked
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            num_torn++;
+            continue;
+        }
+        if (actual != checksum)
+        {
+            std::cerr << "Error: frame " << latest << " fails its checksum" << std::endl;
+            num_corrupt++;
+        }
+        num_frames++;
+        latency_sum += latency;
+        latency_max = std::max(latency_max, latency);
+    }
+
+    printf("Read %llu frames (%llu skipped, %llu overwritten while reading, %llu corrupt), latency %.3lf ms avg, %.3lf ms max\n",
+           (unsigned long long)num_frames, (unsigned long long)num_skipped, (unsigned long long)num_torn, (unsigned long long)num_corrupt,
+           (num_frames > 0) ? latency_sum / num_frames : 0.0, latency_max);
+    munmap(ring, size);
+    return (num_corrupt > 0) ? 1 : 0;
+}
+
+uint64_t monotonicNanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
@@ -1,10 +1,39 @@
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+#include <zlib.h>
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -17,6 +46,7 @@
 //#include "jsobject.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "frame_ring.h"
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
@@ -24,28 +54,326 @@
 
 //#define OFFSCREEN
 
+#define RENDERER_TESSELLATION 0
+#define RENDERER_COMPUTE      1
+#define RENDERER_CUBEMAP      2
+#define RENDERER_SLICES       3
+
+#define STEREO_NONE           0
+#define STEREO_OVER_UNDER     1
+#define STEREO_LAYERED        2
+#define STEREO_SYNTHESIZED    3
+#define LAYOUT_EQUIRECT       0
+#define LAYOUT_EQUAL_AREA     1
+#define PROJECTION_EQUIRECT      0
+#define PROJECTION_DOMEMASTER    1
+#define PROJECTION_CYLINDRICAL   2
+
+#define VARIANT_NO_POLE       1
+#define VARIANT_NO_SEAM       2
+#define VARIANT_CULLED        4 // chunk lies outside the output bounds, not drawn
+
+#define SLICE_BATCH 32 // slices per draw (geometry shader invocations, at least 32 are always supported)
+#define MAX_SLICE_ROWS 16
+#define MAX_VIEWS 64
+#define OUTPUT_PPM            0 // one file per frame
+#define OUTPUT_Y4M            1 // one YUV4MPEG2 stream (4:2:0)
+#define OUTPUT_YUV            2 // one headerless I420 stream
+#define OUTPUT_PNG            3 // one 8-bit RGB file per frame
+#define OUTPUT_EXR            4 // one half-float RGB (+ depth) file per frame
+#define OUTPUT_DELTA          5 // one stream of the tiles that changed since the previous frame
+#define PNG_STRIPE_ROWS       64 // rows deflated per encoder task
+#define PNG_FILTER_ADAPTIVE   5 // after the five filter types of the format
+#define EXR_BLOCK_ROWS        16 // rows per ZIP compressed chunk (fixed by the format)
+#define POINT_CHUNK_SIZE      256
+#define MAX_CAPTURED_TRIANGLES 8388608 // feedback buffer limit (216 bytes per triangle, about 1.8 GB)
+
 typedef struct Model {
     GLuint vertex_array;
     GLuint face_index_count;
+    GLuint point_center_buffer;
+    GLuint point_color_buffer;
+    GLuint point_size_buffer;
 } Model;
 
+typedef struct PointChunk {
+    uint32_t first_point;
+    uint32_t num_points;
+    glm::vec3 center;
+    float radius;
+} PointChunk;
+
 typedef struct Scene {
+    uint32_t version;
     glm::vec3 camera_pos;
     Model model;
     glm::vec3 ambient_light;
     int num_lights;
     uint32_t num_points;
+    std::vector<PointChunk> chunks;
     GLfloat *light_positions;
     GLfloat *light_colors;
 } Scene;
 
+typedef struct GlslProgram {
+    GLuint program;
+    std::map<std::string, GLint> uniforms;
+    uint32_t uniforms_version;
+} GlslProgram;
+
+typedef struct GeometryCapture {
+    bool enabled;
+    bool valid;
+    GLuint feedback;
+    GLuint buffer;
+    GLuint vertex_array;
+    GLuint primitives_query;
+    GLuint capacity;
+    GLuint num_triangles;
+    glm::vec3 camera_position;
+    float camera_offset;
+    uint32_t scene_version;
+    GlslProgram replay_program;
+} GeometryCapture;
+
+typedef struct EyeSynthesis {
+    GLuint framebuffers[2];
+    GLuint color_textures[2];
+    GLuint depth_textures[2];
+    float max_depth_ratio;
+    int max_fill_distance;
+    GlslProgram warp_program;
+    GlslProgram splat_program;
+    GlslProgram fill_program;
+} EyeSynthesis;
+
+typedef struct CubemapRenderer {
+    int requested_face_size;
+    int face_size;
+    GLuint texture;
+    GLuint depth_renderbuffer;
+    GLuint framebuffer;
+    GlslProgram face_program;
+    GlslProgram resample_program;
+} CubemapRenderer;
+
+typedef struct SliceRenderer {
+    int slice_count;
+    int row_count;
+    int cell_width;
+    int cell_height;
+    GLuint color_texture;
+    GLuint depth_texture;
+    GLuint framebuffer;
+    GlslProgram draw_program;
+    GlslProgram resample_program;
+    std::vector<glm::vec4> row_bounds;
+    std::vector<glm::mat4> view_projections;
+} SliceRenderer;
+
+typedef struct RenderLayout {
+    int layout;
+    int width;
+    int height;
+    GLuint texture;
+    GLuint depth_renderbuffer;
+    GLuint framebuffer;
+    GlslProgram resample_program;
+} RenderLayout;
+
+typedef struct ViewBatch {
+    bool enabled;
+    bool layered;
+    int count;
+    int columns;
+    int rows;
+    std::vector<glm::vec3> positions; // relative to the scene camera
+    std::vector<float> offsets;
+} ViewBatch;
+
+typedef struct FrameReadback {
+    int ring_size;
+    bool bgra;
+    int next;
+    int image_width;
+    int layer_height;
+    int num_layers;
+    std::vector<GLuint> buffers;
+    std::vector<GLsync> fences;
+    std::vector<std::string> filenames;
+    uint32_t num_frames;
+    double wait_time;
+} FrameReadback;
+
+typedef struct FrameConversion {
+    bool enabled;
+    bool yuv;
+    bool layered;
+    int width;
+    int height;
+    int layer_height;
+    int target_height;
+    GLuint source_texture;
+    GLuint source_framebuffer;
+    GLuint texture;
+    GLuint framebuffer;
+    GlslProgram program;
+} FrameConversion;
+
+typedef struct OutputPyramid {
+    std::vector<int> levels; // requested levels in ascending order, level `k` is 1/2^k of the rendered size
+    std::vector<int> widths;
+    std::vector<int> heights;
+    std::vector<GLuint> textures; // every level up to the last requested one, 0 is the rendered image
+    std::vector<GLuint> framebuffers;
+    GlslProgram program;
+} OutputPyramid;
+
+typedef struct TileDelta {
+    bool enabled;
+    int tile_size;
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    bool reference_valid;
+    int current;
+    GLuint textures[2]; // copies of the saved frame, alternating between current and previous
+    GLuint framebuffers[2];
+    GLuint flag_texture;
+    GLuint flag_framebuffer;
+    GlslProgram program;
+} TileDelta;
+
+typedef struct SharedFrameRing {
+    bool enabled;
+    std::string name;
+    int num_slots;
+    uint32_t eye;
+    bool checksums;
+    size_t size;
+    uint8_t *memory;
+    FrameRingHeader *header;
+    uint64_t sequence;
+} SharedFrameRing;
+
+typedef struct PreviewServer {
+    bool enabled;
+    int port;
+    int width;
+    int height;
+    int quality;
+    double interval;
+    double last_request;
+    GLuint texture;
+    GLuint framebuffer;
+    GLuint resolve_texture;
+    GLuint resolve_framebuffer;
+    GLuint buffer;
+    GLsync fence;
+    int listen_socket;
+    std::vector<int> clients;
+    std::atomic<int> num_clients;
+    std::atomic<bool> stopping;
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<uint8_t> frame; // latest preview, RGB rows bottom-up
+    bool frame_ready;
+    uint32_t num_sent;
+} PreviewServer;
+
+typedef struct JpegErrorManager {
+    struct jpeg_error_mgr manager;
+    jmp_buf escape;
+} JpegErrorManager;
+
+typedef struct FrameWriteJob {
+    std::string filename;
+    uint8_t *pixels;
+    bool bgra;
+    uint64_t sequence;
+} FrameWriteJob;
+
+typedef struct EncoderBatch {
+    int num_stripes;
+    int next_stripe;
+    int num_done;
+    const std::function<void(int)> *encode_stripe;
+} EncoderBatch;
+
+typedef struct EncoderPool {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable stripe_ready;
+    std::condition_variable batch_done;
+    std::deque<EncoderBatch*> batches; // batches with stripes left to hand out, oldest first
+    bool stopping;
+} EncoderPool;
+
+typedef struct FrameWriter {
+    bool enabled;
+    int num_threads;
+    int queue_size;
+    bool drop_frames;
+    int image_width;
+    int layer_height;
+    int num_layers;
+    int format;
+    bool converted;
+    bool depth;
+    std::vector<int> pyramid_levels;
+    int delta_tile_size;
+    int png_filter;
+    int encoder_threads;
+    EncoderPool encoders;
+    int compression_level;
+    uint16_t srgb_to_half[256];
+    int stream_fps;
+    FILE *stream;
+    uint64_t next_sequence;
+    uint64_t next_write_sequence;
+    std::vector<uint8_t> stream_frame;
+    std::condition_variable stream_turn;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable buffer_free;
+    std::deque<FrameWriteJob> jobs;
+    std::vector<uint8_t*> buffers;
+    std::vector<uint8_t*> free_buffers;
+    bool stopping;
+    uint32_t num_written;
+    uint32_t num_dropped;
+    size_t max_queue_depth;
+    uint64_t bytes_written;
+    uint64_t report_bytes_written;
+    uint64_t tiles_changed;
+    uint64_t tiles_total;
+    double start_time;
+} FrameWriter;
+
 typedef struct App {
+    int renderer;
+    int stereo;
+    float camera_offset;
+    float tess_edge_pixels;
+    bool partial_output;
+    glm::vec4 output_bounds;
+    int projection;
+    float projection_fov;
     GLuint framebuffer;
     GLuint framebuffer_texture;
+    bool distance_output;
+    GLuint distance_texture;
     int framebuffer_width;
     int framebuffer_height;
     GLuint program;
     std::map<std::string,GLint> uniforms;
+    bool classify_chunks;
+    bool specialize_shaders;
+    uint32_t uniforms_version;
+    std::map<std::string, GlslProgram> program_cache;
+    uint32_t variant_chunk_counts[5];
     GLuint vertex_position_attrib;
     GLuint vertex_normal_attrib;
     GLuint vertex_texcoord_attrib;
@@ -54,25 +382,145 @@ typedef struct App {
     GLuint point_size_attrib;
     glm::mat4 mat_model;
     glm::mat3 mat_normal;
+    GlslProgram splat_program;
+    GlslProgram resolve_program;
+    GLuint splat_depth_texture;
+    GLuint splat_color_texture;
+    GLuint empty_vertex_array;
+    GeometryCapture geometry_capture;
+    EyeSynthesis eye_synthesis;
+    CubemapRenderer cubemap;
+    SliceRenderer slices;
+    RenderLayout render_layout;
+    ViewBatch views;
+    FrameReadback readback;
+    FrameConversion conversion;
+    OutputPyramid pyramid;
+    TileDelta delta;
+    SharedFrameRing frame_ring;
+    PreviewServer preview;
+    FrameWriter writer;
     Scene scene;
 } App;
 
 void init(GLFWwindow *window, int width, int height, float camera_offset, const char *scene_filename, App &app_ptr);
 void initializeScene(const char *scene_filename, App &app);
 void initializeUniforms(float camera_offset, App &app);
+void initializePointSplat(App &app);
+void initializeGeometryCapture(App &app);
+void initializeEyeSynthesis(App &app);
+void initializeCubemap(App &app);
+void resizeCubemap(App &app);
+void initializeSlices(App &app);
+void resizeSlices(App &app);
+void updateSliceCameras(App &app);
+void initializeRenderLayout(App &app);
+void resizeRenderLayout(App &app);
+void parseViews(std::string views, float camera_offset, ViewBatch &batch);
+void createPointChunks(GLfloat *point_centers, GLfloat *point_colors, GLfloat *point_sizes, uint32_t num_points, std::vector<PointChunk> &chunks);
+int classifyPointChunk(PointChunk &chunk, App &app);
+void setSceneUniforms(std::map<std::string, GLint> &uniforms, App &app);
+GlslProgram& getProgram(std::string shader_filename_base, std::vector<std::string> defines, App &app);
+void useEquirectProgram(int variant, App &app);
 void idle(GLFWwindow *window, App &app_ptr);
 void render(GLFWwindow *window, App &app_ptr);
+void renderPointSplat(App &app);
+void renderScene(App &app);
+void renderTessellatedPoints(App &app);
+void renderCubemap(App &app);
+void renderSlices(App &app);
+void renderEqualAreaLayout(App &app);
+void renderTiles(int width, int height, int tile_width, int tile_height, const char *filename, App &app);
+int maxFramebufferSize();
+void drawPointChunkRuns(std::vector<int> &chunk_values, int value, GLenum mode, App &app);
+void resetPointAttribOffsets(App &app);
+void benchmarkResolutions(std::string resolutions, std::string renderers, std::string point_fractions, int num_frames, App &app);
+void renderSynthesizedStereo(App &app);
+void synthesizeEye(App &app);
+void presentSynthesizedStereo(App &app);
+void benchmarkEyeSynthesis(int num_frames, App &app);
+void benchmarkSlices(std::string slice_counts, int num_frames, App &app);
+void renderCapturedGeometry(App &app);
+void captureGeometry(App &app);
 void onKeyboard(GLFWwindow *window, int key, int scancode, int action, int mods);
 void saveImage(const char *filename, App &app);
+void getSavedImageSize(App &app, int &image_width, int &layer_height, int &num_layers);
+void initializeFrameReadback(App &app);
+void queueFrameReadback(const char *filename, App &app);
+void completeFrameReadback(int slot, App &app);
+void finishFrameReadback(App &app);
+void initializeSharedFrameRing(App &app);
+uint8_t* beginSharedFrame(App &app);
+void publishSharedFrame(uint64_t timestamp_ns, App &app);
+void finishSharedFrameRing(App &app);
+uint64_t monotonicNanoseconds();
+void initializePreviewServer(App &app);
+void updatePreview(App &app);
+void runPreviewServer(PreviewServer *preview);
+void acceptPreviewClient(int client, PreviewServer &preview);
+bool sendAll(int socket, const void *data, size_t size);
+bool encodeJpeg(const uint8_t *pixels, int width, int height, int quality, std::vector<uint8_t> &jpeg);
+void exitJpegError(j_common_ptr compressor);
+void finishPreviewServer(App &app);
+void writeImage(const char *filename, uint8_t *pixels, int image_width, int layer_height, int num_layers, bool bgra, bool top_down);
+const uint8_t* frameRow(const uint8_t *pixels, int row, int bytes_per_pixel, bool top_down, int image_width, int layer_height);
+void runEncoderStripes(int num_stripes, EncoderPool &pool, const std::function<void(int)> &encode_stripe);
+void runEncoderPool(EncoderPool *pool);
+uint64_t writeFrameImage(const char *filename, uint8_t *pixels, int image_width, int layer_height, int num_layers, bool bgra, bool top_down,
+                         const uint8_t *distances, FrameWriter &writer);
+uint64_t writePng(const char *filename, uint8_t *pixels, int image_width, int height, bool bgra, bool top_down, int layer_height, FrameWriter &writer);
+void filterPngRow(const uint8_t *row, const uint8_t *previous_row, size_t row_bytes, int filter, uint8_t *filtered);
+int paethPredictor(int left, int up, int up_left);
+uint64_t writePngChunk(FILE *fp, const char *type, const uint8_t *data, size_t size);
+void storeBigEndian32(uint8_t *bytes, uint32_t value);
+uint64_t writeExr(const char *filename, uint8_t *pixels, int image_width, int height, bool bgra, bool top_down, int layer_height,
+                  const uint8_t *distances, FrameWriter &writer);
+uint64_t writeDistance(const char *filename, const uint8_t *distances, int image_width, int height, int layer_height);
+void appendExrAttribute(std::vector<uint8_t> &header, const char *name, const char *type, const void *value, int32_t size);
+uint16_t floatToHalf(float value);
+void readFramePixels(void *pixels, bool bgra, bool converted, bool depth, bool pyramid, bool delta, App &app);
+size_t readbackFrameSize(App &app);
+void initializeFrameConversion(App &app);
+void convertFrame(App &app);
+int pyramidLevelSize(int size, int level);
+size_t outputPyramidPixels(App &app);
+void initializeOutputPyramid(App &app);
+void buildOutputPyramid(App &app);
+void initializeTileDelta(App &app);
+void detectChangedTiles(App &app);
+void initializeFrameWriter(App &app);
+uint8_t* acquireFrameBuffer(App &app);
+void submitFrameWrite(const char *filename, uint8_t *pixels, bool bgra, App &app);
+void runFrameWriter(FrameWriter *writer);
+void writeFrame(FrameWriteJob &job, std::vector<uint8_t> &stream_frame, FrameWriter &writer);
+uint32_t encodeTileDelta(const uint8_t *pixels, bool bgra, std::vector<uint8_t> &record, uint32_t &num_tiles, FrameWriter &writer);
+void convertToYuv420(uint8_t *pixels, bool bgra, int image_width, int layer_height, int num_layers, uint8_t *yuv);
+void convertRowsToYuv420(const uint8_t *row0, const uint8_t *row1, int width, bool bgra, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v);
+#ifdef USE_SSE2
+__m128i loadRgbPixels(const uint8_t *pixels, bool last);
+#endif
+void reportFrameWriter(double interval, App &app);
+void finishFrameWriter(App &app);
 void loadShader(std::string shader_filename_base, App &app);
+void loadProgram(std::string shader_filename_base, GlslProgram &glsl_program, App &app,
+                 std::vector<std::string> defines = std::vector<std::string>());
+void loadProgramFiles(std::vector<std::string> shader_filenames, GlslProgram &glsl_program, App &app,
+                      std::vector<std::string> defines = std::vector<std::string>(),
+                      std::vector<std::string> feedback_varyings = std::vector<std::string>());
+std::string injectDefines(const char *source, int32_t length, std::vector<std::string> &defines);
 GLint compileShader(char *source, int32_t length, GLenum type);
 GLuint createShaderProgram(GLuint shaders[], uint32_t num_shaders);
 void linkShaderProgram(GLuint program);
 std::string shaderTypeToString(GLenum type);
+GLenum shaderTypeFromFilename(std::string filename);
 int32_t readFile(const char* filename, char** data_ptr);
+bool fileExists(const char *filename);
+void parseOptions(int argc, char **argv, std::vector<std::string> &args, std::map<std::string, std::string> &options);
+std::string getOption(std::map<std::string, std::string> &options, std::string name, std::string default_value);
+GLint uniformLocation(std::map<std::string, GLint> &uniforms, std::string name);
 GLuint createPointCloudVao(GLfloat *point_centers, GLfloat *point_colors, GLfloat *point_sizes, uint32_t num_points, GLuint position_attrib,
                            GLuint normal_attrib, GLuint texcoord_attrib, GLuint point_center_attrib, GLuint point_color_attrib,
-                           GLuint point_size_attrib, GLuint *face_index_count);
+                           GLuint point_size_attrib, GLuint *face_index_count, GLuint point_buffers[3]);
 
 int main(int argc, char **argv)
 {
@@ -81,10 +529,432 @@ int main(int argc, char **argv)
     int height = 720;
     std::string save_filename = "";
     float camera_offset = 0.0f;
-    if (argc >= 2) width = std::stoi(argv[1]);
-    if (argc >= 3) height = std::stoi(argv[2]);
-    if (argc >= 4) camera_offset = std::stof(argv[3]);
-    if (argc >= 5) save_filename = argv[4];
+    std::vector<std::string> args;
+    std::map<std::string, std::string> options;
+    parseOptions(argc, argv, args, options);
+    if (args.size() >= 1) width = std::stoi(args[0]);
+    if (args.size() >= 2) height = std::stoi(args[1]);
+    if (args.size() >= 3) camera_offset = std::stof(args[2]);
+    if (args.size() >= 4) save_filename = args[3];
+
+    // Read command line options
+    App app;
+    app.geometry_capture.enabled = getOption(options, "capture-geometry", "0") == "1";
+    app.classify_chunks = getOption(options, "classify-chunks", "1") == "1";
+    app.specialize_shaders = getOption(options, "specialize-shaders", "1") == "1";
+    float tess_edge_pixels = std::stof(getOption(options, "tess-edge-pixels", "32"));
+    float tess_quality = std::stof(getOption(options, "tess-quality", "1"));
+    if (!(tess_edge_pixels > 0.0f) || !(tess_quality > 0.0f))
+    {
+        std::cerr << "Error: tessellation edge length and quality must be positive" << std::endl;
+        exit(1);
+    }
+    app.tess_edge_pixels = tess_edge_pixels / tess_quality;
+    std::string renderer = getOption(options, "renderer", "tessellation");
+    if (renderer == "tessellation")
+    {
+        app.renderer = RENDERER_TESSELLATION;
+    }
+    else if (renderer == "compute")
+    {
+        app.renderer = RENDERER_COMPUTE;
+    }
+    else if (renderer == "cubemap")
+    {
+        app.renderer = RENDERER_CUBEMAP;
+    }
+    else if (renderer == "slices")
+    {
+        app.renderer = RENDERER_SLICES;
+    }
+    else
+    {
+        std::cerr << "Error: unknown renderer '" << renderer << "'" << std::endl;
+        exit(1);
+    }
+    if (app.renderer == RENDERER_CUBEMAP && camera_offset != 0.0f)
+    {
+        std::cerr << "Error: cubemap renderer only supports mono output (camera offset 0)" << std::endl;
+        exit(1);
+    }
+    app.cubemap.requested_face_size = std::stoi(getOption(options, "cube-face-size", "0"));
+    app.slices.slice_count = std::stoi(getOption(options, "slice-count", "64"));
+    app.slices.row_count = std::stoi(getOption(options, "slice-rows", "3"));
+    if (app.slices.slice_count < 4 || app.slices.row_count < 2 || app.slices.row_count > MAX_SLICE_ROWS)
+    {
+        std::cerr << "Error: slice renderer needs at least 4 slices and 2 to " << MAX_SLICE_ROWS << " rows" << std::endl;
+        exit(1);
+    }
+    std::string stereo = getOption(options, "stereo", "none");
+    if (stereo == "none")
+    {
+        app.stereo = STEREO_NONE;
+    }
+    else if (stereo == "over-under")
+    {
+        app.stereo = STEREO_OVER_UNDER;
+    }
+    else if (stereo == "layered")
+    {
+        app.stereo = STEREO_LAYERED;
+    }
+    else if (stereo == "synthesized")
+    {
+        app.stereo = STEREO_SYNTHESIZED;
+    }
+    else
+    {
+        std::cerr << "Error: unknown stereo mode '" << stereo << "'" << std::endl;
+        exit(1);
+    }
+    if (app.stereo != STEREO_NONE && (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled))
+    {
+        std::cerr << "Error: single-pass stereo requires the tessellation renderer without geometry capture" << std::endl;
+        exit(1);
+    }
+    // Output may cover only part of the sphere (e.g. VR180 is `--longitude-range -90,90`)
+    float bounds[4];
+    if (sscanf(getOption(options, "longitude-range", "-180,180").c_str(), "%f,%f", &bounds[0], &bounds[1]) != 2 ||
+        sscanf(getOption(options, "latitude-range", "-90,90").c_str(), "%f,%f", &bounds[2], &bounds[3]) != 2 ||
+        bounds[0] < -180.0f || bounds[1] > 180.0f || bounds[0] >= bounds[1] || bounds[2] < -90.0f || bounds[3] > 90.0f || bounds[2] >= bounds[3])
+    {
+        std::cerr << "Error: output ranges must be `min,max` in degrees within -180,180 (longitude) and -90,90 (latitude)" << std::endl;
+        exit(1);
+    }
+    app.output_bounds = glm::vec4(bounds[0], bounds[1], bounds[2], bounds[3]) * (float)(M_PI / 180.0);
+    app.partial_output = bounds[0] != -180.0f || bounds[1] != 180.0f || bounds[2] != -90.0f || bounds[3] != 90.0f;
+    // Output projection of the tessellation pipeline
+    std::string projection = getOption(options, "projection", "equirect");
+    if (projection == "equirect")
+    {
+        app.projection = PROJECTION_EQUIRECT;
+    }
+    else if (projection == "domemaster")
+    {
+        app.projection = PROJECTION_DOMEMASTER;
+    }
+    else if (projection == "cylindrical")
+    {
+        app.projection = PROJECTION_CYLINDRICAL;
+    }
+    else
+    {
+        std::cerr << "Error: unknown projection '" << projection << "'" << std::endl;
+        exit(1);
+    }
+    float projection_fov = std::stof(getOption(options, "projection-fov", (app.projection == PROJECTION_CYLINDRICAL) ? "90" : "180"));
+    if ((app.projection == PROJECTION_DOMEMASTER && (projection_fov <= 0.0f || projection_fov >= 360.0f)) ||
+        (app.projection == PROJECTION_CYLINDRICAL && (projection_fov <= 0.0f || projection_fov >= 180.0f)))
+    {
+        std::cerr << "Error: projection field of view must be below 360 (domemaster) or 180 (cylindrical) degrees" << std::endl;
+        exit(1);
+    }
+    app.projection_fov = projection_fov * M_PI / 180.0;
+    std::string render_layout = getOption(options, "layout", "equirect");
+    if (render_layout == "equirect")
+    {
+        app.render_layout.layout = LAYOUT_EQUIRECT;
+    }
+    else if (render_layout == "equal-area")
+    {
+        app.render_layout.layout = LAYOUT_EQUAL_AREA;
+    }
+    else
+    {
+        std::cerr << "Error: unknown layout '" << render_layout << "'" << std::endl;
+        exit(1);
+    }
+    if (app.render_layout.layout != LAYOUT_EQUIRECT &&
+        (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled || app.stereo != STEREO_NONE))
+    {
+        std::cerr << "Error: internal layouts require the single eye tessellation renderer without geometry capture" << std::endl;
+        exit(1);
+    }
+    if (app.partial_output && (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled ||
+        app.stereo == STEREO_SYNTHESIZED || app.render_layout.layout != LAYOUT_EQUIRECT))
+    {
+        std::cerr << "Error: output ranges require the tessellation renderer without geometry capture, synthesized stereo or internal layouts" << std::endl;
+        exit(1);
+    }
+    if (app.projection != PROJECTION_EQUIRECT && (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled ||
+        app.stereo == STEREO_SYNTHESIZED || app.render_layout.layout != LAYOUT_EQUIRECT || app.partial_output))
+    {
+        std::cerr << "Error: domemaster and cylindrical projections require the tessellation renderer without geometry capture, "
+                  << "synthesized stereo, internal layouts or output ranges" << std::endl;
+        exit(1);
+    }
+    // Batch of viewpoints rendered with one submission, into atlas tiles or array layers
+    std::string views = getOption(options, "views", "");
+    app.views.enabled = views != "";
+    if (app.views.enabled)
+    {
+        parseViews(views, camera_offset, app.views);
+        std::string views_layout = getOption(options, "views-layout", "atlas");
+        if (views_layout != "atlas" && views_layout != "layered")
+        {
+            std::cerr << "Error: unknown views layout '" << views_layout << "'" << std::endl;
+            exit(1);
+        }
+        app.views.layered = views_layout == "layered";
+        app.views.columns = app.views.layered ? 1 : (int)ceil(sqrt((double)app.views.count));
+        app.views.rows = app.views.layered ? 1 : (app.views.count + app.views.columns - 1) / app.views.columns;
+        if (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled || app.stereo != STEREO_NONE ||
+            app.render_layout.layout != LAYOUT_EQUIRECT || app.partial_output)
+        {
+            std::cerr << "Error: view batches require the tessellation renderer without geometry capture, stereo modes, "
+                      << "internal layouts or output ranges (give each eye its own view instead)" << std::endl;
+            exit(1);
+        }
+        if (getOption(options, "benchmark-resolutions", "") != "" || getOption(options, "benchmark-slices", "") != "")
+        {
+            std::cerr << "Error: view batches cannot be benchmarked across resolutions or slice counts" << std::endl;
+            exit(1);
+        }
+    }
+    // Outputs beyond the maximum framebuffer size are rendered in tiles and streamed to the save file
+    // (`--tile-size 4096` or `4096x512`)
+    int tile_width = 0;
+    int tile_height = 0;
+    std::string tile_size = getOption(options, "tile-size", "0");
+    int num_tile_dims = sscanf(tile_size.c_str(), "%dx%d", &tile_width, &tile_height);
+    if (num_tile_dims == 1)
+    {
+        tile_height = tile_width;
+    }
+    if (num_tile_dims < 1 || tile_width < 0 || tile_height < 0 || (tile_width == 0) != (tile_height == 0))
+    {
+        std::cerr << "Error: tile size must be `size` or `widthxheight` in pixels" << std::endl;
+        exit(1);
+    }
+    bool tiled = tile_width > 0;
+    if (tiled && (app.renderer != RENDERER_TESSELLATION || app.geometry_capture.enabled || app.stereo != STEREO_NONE ||
+        app.render_layout.layout != LAYOUT_EQUIRECT || app.projection != PROJECTION_EQUIRECT || app.views.enabled))
+    {
+        std::cerr << "Error: tiled output requires the single eye tessellation renderer without geometry capture, "
+                  << "internal layouts, other projections or view batches" << std::endl;
+        exit(1);
+    }
+    if (tiled && save_filename == "")
+    {
+        std::cerr << "Error: tiled output needs a save filename" << std::endl;
+        exit(1);
+    }
+    if (app.stereo == STEREO_SYNTHESIZED && camera_offset == 0.0f)
+    {
+        std::cerr << "Error: synthesized stereo requires a non-zero camera offset" << std::endl;
+        exit(1);
+    }
+    // Saved frames are read back through a ring of pixel buffer objects (0 reads each frame synchronously), shared
+    // memory output always reads straight into the ring slot, a mapped buffer would have to be copied there
+    app.readback.ring_size = std::stoi(getOption(options, "readback-buffers", (getOption(options, "shm-output", "") != "") ? "0" : "3"));
+    app.readback.bgra = getOption(options, "readback-format", "bgra") == "bgra";
+    if (app.readback.ring_size < 0 || (getOption(options, "readback-format", "bgra") != "bgra" && getOption(options, "readback-format", "bgra") != "rgb"))
+    {
+        std::cerr << "Error: readback needs a non-negative buffer count and format `bgra` or `rgb`" << std::endl;
+        exit(1);
+    }
+    // Saved frames are encoded and written by a pool of worker threads fed by a bounded queue of frame buffers
+    // (0 threads writes on the render thread, `drop` skips frames instead of waiting when the queue is full)
+    app.writer.num_threads = std::stoi(getOption(options, "writer-threads", "2"));
+    app.writer.queue_size = std::stoi(getOption(options, "writer-queue", "8"));
+    std::string backpressure = getOption(options, "writer-backpressure", "block");
+    app.writer.drop_frames = backpressure == "drop";
+    if (app.writer.num_threads < 0 || app.writer.queue_size < 1 || (backpressure != "block" && backpressure != "drop"))
+    {
+        std::cerr << "Error: frame writer needs a non-negative thread count, a queue of at least 1 frame and back-pressure `block` or `drop`" << std::endl;
+        exit(1);
+    }
+    // Frames can also be streamed as video to one file, or to stdout (save filename `-`) for piping into an encoder
+    std::string output_format = getOption(options, "output-format", "ppm");
+    if (output_format == "ppm")
+    {
+        app.writer.format = OUTPUT_PPM;
+    }
+    else if (output_format == "y4m")
+    {
+        app.writer.format = OUTPUT_Y4M;
+    }
+    else if (output_format == "yuv")
+    {
+        app.writer.format = OUTPUT_YUV;
+    }
+    else if (output_format == "png")
+    {
+        app.writer.format = OUTPUT_PNG;
+    }
+    else if (output_format == "exr")
+    {
+        app.writer.format = OUTPUT_EXR;
+    }
+    else if (output_format == "delta")
+    {
+        app.writer.format = OUTPUT_DELTA;
+    }
+    else
+    {
+        std::cerr << "Error: unknown output format '" << output_format << "'" << std::endl;
+        exit(1);
+    }
+    bool video_output = app.writer.format == OUTPUT_Y4M || app.writer.format == OUTPUT_YUV;
+    bool stream_output = video_output || app.writer.format == OUTPUT_DELTA;
+    app.writer.stream_fps = std::stoi(getOption(options, "output-fps", "30"));
+    if (app.writer.format != OUTPUT_PPM && tiled)
+    {
+        std::cerr << "Error: tiled output is always saved as a single PPM" << std::endl;
+        exit(1);
+    }
+    if (save_filename == "-" && !stream_output)
+    {
+        std::cerr << "Error: only video and delta output formats can be written to stdout" << std::endl;
+        exit(1);
+    }
+    // PNG and EXR frames are compressed in stripes by the writer thread and a pool of encoder threads shared by all writers
+    app.writer.encoder_threads = std::stoi(getOption(options, "encoder-threads", "4"));
+    app.writer.compression_level = std::stoi(getOption(options, "compression-level", "6"));
+    // (rendered frames with flat backgrounds deflate best unfiltered, photographic content with adaptive filtering)
+    const char *png_filters[6] = {"none", "sub", "up", "average", "paeth", "adaptive"};
+    std::string png_filter = getOption(options, "png-filter", "none");
+    app.writer.png_filter = std::find(png_filters, png_filters + 6, png_filter) - png_filters;
+    if (app.writer.encoder_threads < 1 || app.writer.compression_level < 0 || app.writer.compression_level > 9 || app.writer.png_filter > PNG_FILTER_ADAPTIVE)
+    {
+        std::cerr << "Error: encoders need at least 1 thread, a compression level from 0 to 9 and a known PNG filter" << std::endl;
+        exit(1);
+    }
+    // Distance to the camera is rendered into a second (float) target in the same pass and saved with each frame,
+    // as the `Z` channel of EXR frames or next to PPM and PNG frames as `<frame>_depth.pfm`
+    app.distance_output = getOption(options, "depth-output", "0") == "1";
+    app.writer.depth = app.distance_output;
+    if (app.distance_output && (save_filename == "" || stream_output || tiled || app.renderer != RENDERER_TESSELLATION ||
+        app.geometry_capture.enabled || app.stereo == STEREO_SYNTHESIZED || app.render_layout.layout != LAYOUT_EQUIRECT))
+    {
+        std::cerr << "Error: depth output requires saved image frames from the tessellation renderer without geometry capture, "
+                  << "synthesized stereo or internal layouts" << std::endl;
+        exit(1);
+    }
+    // Filtered levels of the equirect (`1,2,5` for half, quarter and 1/32 size) are built on the GPU from the same
+    // render and saved next to each frame as `<frame>_mip<level>`
+    std::stringstream level_list(getOption(options, "output-levels", ""));
+    std::string level;
+    while (std::getline(level_list, level, ','))
+    {
+        int pyramid_level = std::stoi(level);
+        if (pyramid_level < 1 || (std::min(width, height) >> pyramid_level) < 1)
+        {
+            std::cerr << "Error: output levels must be between 1 and " << (int)log2(std::min(width, height)) << ", got '" << level << "'" << std::endl;
+            exit(1);
+        }
+        app.pyramid.levels.push_back(pyramid_level);
+    }
+    std::sort(app.pyramid.levels.begin(), app.pyramid.levels.end());
+    app.pyramid.levels.erase(std::unique(app.pyramid.levels.begin(), app.pyramid.levels.end()), app.pyramid.levels.end());
+    app.writer.pyramid_levels = app.pyramid.levels;
+    if (!app.pyramid.levels.empty() && (save_filename == "" || stream_output || tiled || app.stereo != STEREO_NONE || app.views.enabled ||
+        app.projection != PROJECTION_EQUIRECT || app.partial_output))
+    {
+        std::cerr << "Error: output levels require saved image frames of a full single eye equirect without view batches" << std::endl;
+        exit(1);
+    }
+    // Delta streams keep only the tiles of each frame that differ from the previous frame (compared on the GPU),
+    // every frame depends on the one before, so none may be dropped
+    app.delta.enabled = app.writer.format == OUTPUT_DELTA;
+    app.delta.tile_size = std::stoi(getOption(options, "delta-tile-size", "64"));
+    app.writer.delta_tile_size = app.delta.tile_size;
+    if (app.delta.enabled && (app.delta.tile_size < 1 || app.writer.drop_frames || app.stereo == STEREO_LAYERED ||
+        (app.views.enabled && app.views.layered)))
+    {
+        std::cerr << "Error: delta output needs a positive tile size, back-pressure `block` and a saved image without layers" << std::endl;
+        exit(1);
+    }
+    // Frames can be published into a POSIX shared memory ring (`--shm-output /name`) instead of being saved,
+    // see `frame_ring.h` for its layout and `frame_ring_consumer` for a reader
+    app.frame_ring.name = getOption(options, "shm-output", "");
+    app.frame_ring.enabled = app.frame_ring.name != "";
+    app.frame_ring.num_slots = std::stoi(getOption(options, "shm-slots", "4"));
+    app.frame_ring.checksums = getOption(options, "shm-checksum", "0") == "1";
+    app.frame_ring.eye = (app.stereo != STEREO_NONE) ? FRAME_RING_EYE_STEREO :
+                         ((camera_offset < 0.0f) ? FRAME_RING_EYE_LEFT : ((camera_offset > 0.0f) ? FRAME_RING_EYE_RIGHT : FRAME_RING_EYE_MONO));
+    if (app.frame_ring.enabled && (save_filename != "" || app.writer.format != OUTPUT_PPM || tiled || app.views.enabled ||
+        app.frame_ring.num_slots < 2 || app.frame_ring.name[0] != '/' || app.readback.ring_size > 0))
+    {
+        std::cerr << "Error: shared memory output needs a name starting with `/`, at least 2 slots, no save filename or output format, "
+                  << "tiles, view batches or readback buffers (frames are read straight into the ring)" << std::endl;
+        exit(1);
+    }
+#ifdef _WIN32
+    if (app.frame_ring.enabled)
+    {
+        std::cerr << "Error: shared memory output is not supported on Windows" << std::endl;
+        exit(1);
+    }
+#endif
+    // Downscaled MJPEG stream of the latest frame on `http://127.0.0.1:<port>/`, read back and encoded at
+    // `--preview-fps` only while someone is watching
+    app.preview.port = std::stoi(getOption(options, "preview-port", "0"));
+    app.preview.enabled = app.preview.port != 0;
+    app.preview.width = std::stoi(getOption(options, "preview-width", "640"));
+    app.preview.interval = 1.0 / std::stof(getOption(options, "preview-fps", "5"));
+    app.preview.quality = std::stoi(getOption(options, "preview-quality", "75"));
+    if (app.preview.enabled && (app.preview.port < 0 || app.preview.port > 65535 || app.preview.width < 16 || app.preview.interval <= 0.0 ||
+        app.preview.quality < 1 || app.preview.quality > 100 || tiled))
+    {
+        std::cerr << "Error: preview needs a port up to 65535, a width of at least 16 pixels, a positive frame rate, "
+                  << "a JPEG quality from 1 to 100 and no tiles" << std::endl;
+        exit(1);
+    }
+#ifdef _WIN32
+    if (app.preview.enabled)
+    {
+        std::cerr << "Error: the preview server is not supported on Windows" << std::endl;
+        exit(1);
+    }
+#endif
+    app.writer.stream = NULL;
+    if (stream_output && save_filename == "-")
+    {
+#ifdef _WIN32
+        std::cerr << "Error: streaming to stdout is not supported on Windows" << std::endl;
+        exit(1);
+#else
+        // keep the real stdout for frames, everything printed goes to stderr from here on
+        fflush(stdout);
+        app.writer.stream = fdopen(dup(STDOUT_FILENO), "wb");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+    }
+    else if (stream_output && save_filename != "")
+    {
+        const char *stream_extensions[6] = {"", ".y4m", ".yuv", "", "", ".delta"};
+        std::string stream_filename = "output/" + save_filename + stream_extensions[app.writer.format];
+        app.writer.stream = fopen(stream_filename.c_str(), "wb");
+        if (app.writer.stream == NULL)
+        {
+            std::cerr << "Error: cannot open " << stream_filename << std::endl;
+            exit(1);
+        }
+    }
+    // Saved frames are converted to their delivery layout on the GPU before readback (I420 planes for video,
+    // top-down rows for image files), `0` reads the rendered image back as is and converts it on the writer threads
+    app.conversion.enabled = getOption(options, "gpu-convert", "1") == "1" && (save_filename != "" || app.frame_ring.enabled);
+    app.conversion.yuv = video_output;
+    app.eye_synthesis.max_depth_ratio = std::stof(getOption(options, "synthesis-depth-ratio", "1.05"));
+    app.eye_synthesis.max_fill_distance = std::stoi(getOption(options, "synthesis-fill-distance", "64"));
+#ifndef OFFSCREEN
+    if (app.stereo == STEREO_LAYERED)
+    {
+        std::cerr << "Error: layered stereo requires an offscreen build" << std::endl;
+        exit(1);
+    }
+    if (app.views.enabled && app.views.layered)
+    {
+        std::cerr << "Error: layered view batches require an offscreen build" << std::endl;
+        exit(1);
+    }
+    if (app.distance_output)
+    {
+        std::cerr << "Error: depth output requires an offscreen build" << std::endl;
+        exit(1);
+    }
+#endif
 
     // Initialize GLFW
     if (!glfwInit())
@@ -94,16 +964,31 @@ int main(int argc, char **argv)
     }
 
     // Create a window and its OpenGL context
+    // (compute shaders and image load/store require OpenGL 4.3)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, (app.renderer == RENDERER_COMPUTE) ? 3 : 1);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef OFFSCREEN
     GLFWwindow *window = glfwCreateWindow(128, 64, "OmniStereo", NULL, NULL);
 #else
     glfwWindowHint(GLFW_SAMPLES, 4);
-    GLFWwindow *window = glfwCreateWindow(width, height, "OmniStereo", NULL, NULL);
+    bool over_under = app.stereo == STEREO_OVER_UNDER || app.stereo == STEREO_SYNTHESIZED;
+    int window_width = app.views.enabled ? app.views.columns * width : width;
+    int window_height = app.views.enabled ? app.views.rows * height : (over_under ? 2 * height : height);
+    if (tiled)
+    {
+        // tiles have their own target, the window only hosts the context
+        window_width = std::min(width, tile_width);
+        window_height = std::min(height, tile_height);
+    }
+    GLFWwindow *window = glfwCreateWindow(window_width, window_height, "OmniStereo", NULL, NULL);
 #endif
+    if (window == NULL)
+    {
+        std::cerr << "Error: could not create window with an OpenGL 4." << ((app.renderer == RENDERER_COMPUTE) ? 3 : 1) << " context" << std::endl;
+        exit(1);
+    }
 
     // Make window's context current
     glfwMakeContextCurrent(window);
@@ -120,14 +1005,69 @@ int main(int argc, char **argv)
     // User input callbacks
     glfwSetKeyCallback(window, onKeyboard);
 
+    if (!tiled && std::max(width, height) > maxFramebufferSize())
+    {
+        std::cerr << "Error: " << width << "x" << height << " output exceeds the maximum framebuffer size " << maxFramebufferSize()
+                  << " (use `--tile-size`)" << std::endl;
+        exit(1);
+    }
+
     // Main render loop
-    App app;
     //init(window, width, height, camera_offset, "resrc/ScanLook_Vehicle07_scene.pvr", app);
+    if (tiled)
+    {
+        init(window, std::min(width, tile_width), std::min(height, tile_height), camera_offset, "resrc/gromacs_full-equil.pvr", app);
+        renderTiles(width, height, tile_width, tile_height, ("output/" + save_filename + "_00001.ppm").c_str(), app);
+        glDeleteVertexArrays(1, &(app.empty_vertex_array));
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
     init(window, width, height, camera_offset, "resrc/gromacs_full-equil.pvr", app);
 
+    // Benchmark tessellation across output resolutions instead of running interactively
+    std::string benchmark_resolutions = getOption(options, "benchmark-resolutions", "");
+    if (benchmark_resolutions != "")
+    {
+        benchmarkResolutions(benchmark_resolutions, getOption(options, "benchmark-renderers", renderer),
+                             getOption(options, "benchmark-point-fractions", "1"), std::stoi(getOption(options, "benchmark-frames", "10")), app);
+        glDeleteVertexArrays(1, &(app.empty_vertex_array));
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    // Compare slice renderer cost and accuracy against the tessellated projection instead of running interactively
+    std::string benchmark_slices = getOption(options, "benchmark-slices", "");
+    if (benchmark_slices != "")
+    {
+        benchmarkSlices(benchmark_slices, std::stoi(getOption(options, "benchmark-frames", "10")), app);
+        glDeleteVertexArrays(1, &(app.empty_vertex_array));
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    // Compare synthesized second eye against a full render instead of running interactively
+    if (getOption(options, "benchmark-synthesis", "0") == "1")
+    {
+        benchmarkEyeSynthesis(std::stoi(getOption(options, "benchmark-frames", "10")), app);
+        glDeleteVertexArrays(1, &(app.empty_vertex_array));
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    app.writer.enabled = save_filename != "";
+    if (app.writer.enabled)
+    {
+        initializeFrameWriter(app);
+    }
+
     int frame_idx = 1;
     char output_filename[128];
-    sprintf(output_filename, "output/%s_%05d.ppm", save_filename.c_str(), frame_idx);
+    const char *frame_extension = (app.writer.format == OUTPUT_PNG) ? "png" : ((app.writer.format == OUTPUT_EXR) ? "exr" : "ppm");
+    sprintf(output_filename, "output/%s_%05d.%s", save_filename.c_str(), frame_idx, frame_extension);
     double previous_time = glfwGetTime();
     int frame_count = 0;
     render(window, app);
@@ -135,9 +1075,31 @@ int main(int argc, char **argv)
     while (!glfwWindowShouldClose(window))
     {
         // Save image
-        if (save_filename != "")
+        if (save_filename != "" && app.readback.ring_size > 0)
+        {
+            queueFrameReadback(output_filename, app);
+        }
+        else if (app.frame_ring.enabled)
+        {
+            // synchronous readback straight into the next slot of the shared ring
+            uint64_t timestamp_ns = monotonicNanoseconds();
+            readFramePixels(beginSharedFrame(app), app.readback.bgra, app.conversion.enabled, false, false, false, app);
+            publishSharedFrame(timestamp_ns, app);
+        }
+        else if (save_filename != "")
+        {
+            // synchronous readback, encoding and writing still happen on the writer threads
+            uint8_t *pixels = acquireFrameBuffer(app);
+            if (pixels != NULL)
+            {
+                readFramePixels(pixels, app.readback.bgra, app.conversion.enabled, app.writer.depth, !app.pyramid.levels.empty(), app.delta.enabled, app);
+                submitFrameWrite(output_filename, pixels, app.readback.bgra, app);
+            }
+        }
+
+        if (app.preview.enabled)
         {
-            saveImage(output_filename, app);
+            updatePreview(app);
         }
 
         // Measure speed
@@ -146,7 +1108,25 @@ int main(int argc, char **argv)
         // Print every 2 seconds
         if (current_time - previous_time >= 2.0)
         {
-            printf("%.3lf FPS (%.3lf avg frame time)\n", (double)frame_count / (current_time - previous_time), (current_time - previous_time) / (double)frame_count);
+            double fps = (double)frame_count / (current_time - previous_time);
+            int num_views = app.views.enabled ? app.views.count : 1;
+            printf("%.3lf FPS (%.3lf avg frame time, %.3lf Mpoints/s)\n", fps, (current_time - previous_time) / (double)frame_count,
+                   fps * app.scene.num_points * num_views / 1.0e6);
+            if (app.geometry_capture.enabled && app.geometry_capture.valid)
+            {
+                printf("    geometry capture: %u triangles\n", app.geometry_capture.num_triangles);
+            }
+            // chunk counts of the last frame drawn by the tessellation renderer
+            if (app.classify_chunks && std::accumulate(app.variant_chunk_counts, app.variant_chunk_counts + 5, 0u) > 0)
+            {
+                printf("    shader variants: %u full, %u no pole, %u no seam/pole, %u outside bounds (of %u chunks)\n", app.variant_chunk_counts[0],
+                       app.variant_chunk_counts[VARIANT_NO_POLE], app.variant_chunk_counts[VARIANT_NO_POLE | VARIANT_NO_SEAM],
+                       app.variant_chunk_counts[VARIANT_CULLED], (uint32_t)app.scene.chunks.size());
+            }
+            if (app.writer.enabled)
+            {
+                reportFrameWriter(current_time - previous_time, app);
+            }
 
             frame_count = 0;
             previous_time = current_time;
@@ -156,10 +1136,27 @@ int main(int argc, char **argv)
         idle(window, app);
 
         frame_idx++;
-        sprintf(output_filename, "output/%s_%05d.ppm", save_filename.c_str(), frame_idx);
+        sprintf(output_filename, "output/%s_%05d.%s", save_filename.c_str(), frame_idx, frame_extension);
     }
 
     // clean up
+    if (save_filename != "" && app.readback.ring_size > 0)
+    {
+        finishFrameReadback(app);
+    }
+    if (app.frame_ring.enabled)
+    {
+        finishSharedFrameRing(app);
+    }
+    if (app.preview.enabled)
+    {
+        finishPreviewServer(app);
+    }
+    if (app.writer.enabled)
+    {
+        finishFrameWriter(app);
+    }
+    glDeleteVertexArrays(1, &(app.empty_vertex_array));
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -173,59 +1170,151 @@ void init(GLFWwindow *window, int width, int height, float camera_offset, const
 
     // Initialize OpenGL
 #ifdef OFFSCREEN
-    // texture to render into
-    glGenTextures(1, &(app.framebuffer_texture));
-    glBindTexture(GL_TEXTURE_2D, app.framebuffer_texture);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    if (app.stereo == STEREO_LAYERED || (app.views.enabled && app.views.layered))
+    {
+        // one array layer per eye or view (color and depth), the geometry shader selects the layer
+        int num_layers = app.views.enabled ? app.views.count : 2;
+        GLuint framebuffer_depth;
+        glGenTextures(1, &(app.framebuffer_texture));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, app.framebuffer_texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenTextures(1, &framebuffer_depth);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, framebuffer_depth);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, num_layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+        if (app.distance_output)
+        {
+            glGenTextures(1, &(app.distance_texture));
+            glBindTexture(GL_TEXTURE_2D_ARRAY, app.distance_texture);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, width, height, num_layers, 0, GL_RED, GL_FLOAT, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // layered offscreen framebuffer
+        glGenFramebuffers(1, &(app.framebuffer));
+        glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, app.framebuffer_texture, 0);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, framebuffer_depth, 0);
+        if (app.distance_output)
+        {
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, app.distance_texture, 0);
+        }
+    }
+    else
+    {
+        // over-under stereo stacks both eyes in one double height target, view batches tile an atlas
+        int target_width = app.views.enabled ? app.views.columns * width : width;
+        int target_height = (app.stereo == STEREO_OVER_UNDER || app.stereo == STEREO_SYNTHESIZED) ? 2 * height : height;
+        if (app.views.enabled)
+        {
+            target_height = app.views.rows * height;
+        }
 
-    // depth buffer for offscreen framebuffer
-    GLuint framebuffer_depth;
-    glGenRenderbuffers(1, &framebuffer_depth);
-    glBindRenderbuffer(GL_RENDERBUFFER, framebuffer_depth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        // texture to render into
+        glGenTextures(1, &(app.framebuffer_texture));
+        glBindTexture(GL_TEXTURE_2D, app.framebuffer_texture);
 
-    // offscreen framebuffer
-    glGenFramebuffers(1, &(app.framebuffer));
-    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, app.framebuffer_texture, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, framebuffer_depth);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, target_width, target_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        if (app.distance_output)
+        {
+            // linear distance to the camera, written by the fragment shader next to the color
+            glGenTextures(1, &(app.distance_texture));
+            glBindTexture(GL_TEXTURE_2D, app.distance_texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, target_width, target_height, 0, GL_RED, GL_FLOAT, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // depth buffer for offscreen framebuffer
+        GLuint framebuffer_depth;
+        glGenRenderbuffers(1, &framebuffer_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, framebuffer_depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, target_width, target_height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        // offscreen framebuffer
+        glGenFramebuffers(1, &(app.framebuffer));
+        glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, app.framebuffer_texture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, framebuffer_depth);
+        if (app.distance_output)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, app.distance_texture, 0);
+        }
+    }
 
-    // set the list of draw buffers
-    GLenum draw_buffers[1] = {GL_COLOR_ATTACHMENT0};
-    glDrawBuffers(1, draw_buffers);
+    // set the list of draw buffers (color, and distance when saved)
+    GLenum draw_buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(app.distance_output ? 2 : 1, draw_buffers);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     //GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     //std::cout << "FRAMEBUFFER STATUS: [" << status << "]" << std::endl;
 
-    // save framebuffer dimensions
+    // save framebuffer dimensions (per eye)
     app.framebuffer_width = width;
     app.framebuffer_height = height;
 #else
-    // save framebuffer dimensions
+    // save framebuffer dimensions (per eye)
     int w, h;
     glfwGetFramebufferSize(window, &w, &h);
     app.framebuffer = 0;
     app.framebuffer_width = w;
-    app.framebuffer_height = h;
+    app.framebuffer_height = (app.stereo == STEREO_OVER_UNDER || app.stereo == STEREO_SYNTHESIZED) ? h / 2 : h;
+    if (app.views.enabled)
+    {
+        app.framebuffer_width = w / app.views.columns;
+        app.framebuffer_height = h / app.views.rows;
+    }
 #endif
 
     std::cout << "Framebuffer size: " << app.framebuffer_width << "x" << app.framebuffer_height << std::endl;
     
     glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
-    glClearColor(0.68, 0.85, 0.95, 1.0);
+    if (app.stereo == STEREO_OVER_UNDER)
+    {
+        // left eye (viewport 0) in the top half, right eye (viewport 1) in the bottom half
+        glViewportIndexedf(0, 0.0f, app.framebuffer_height, app.framebuffer_width, app.framebuffer_height);
+        glViewportIndexedf(1, 0.0f, 0.0f, app.framebuffer_width, app.framebuffer_height);
+    }
+    if (app.views.enabled && !app.views.layered)
+    {
+        // one viewport per view, first view in the top left tile
+        GLint max_viewports;
+        glGetIntegerv(GL_MAX_VIEWPORTS, &max_viewports);
+        if (app.views.count > max_viewports)
+        {
+            std::cerr << "Error: view atlas needs " << app.views.count << " viewports, OpenGL supports " << max_viewports
+                      << " (use `--views-layout layered`)" << std::endl;
+            exit(1);
+        }
+        int i;
+        for (i = 0; i < app.views.count; i++)
+        {
+            int column = i % app.views.columns;
+            int row = app.views.rows - 1 - (i / app.views.columns);
+            glViewportIndexedf(i, column * app.framebuffer_width, row * app.framebuffer_height, app.framebuffer_width, app.framebuffer_height);
+        }
+    }
+    glClearColor(0.68, 0.85, 0.95, 1.0);
     glEnable(GL_DEPTH_TEST);
 #ifndef OFFSCREEN
     glEnable(GL_MULTISAMPLE);
 #endif
     glPatchParameteri(GL_PATCH_VERTICES, 3);
 
+    // Fullscreen passes and pixel grids are generated from `gl_VertexID`, but core profile still requires a bound VAO
+    glGenVertexArrays(1, &(app.empty_vertex_array));
+
     // Initialize application
     app.vertex_position_attrib = 0;
     app.vertex_normal_attrib = 1;
@@ -235,253 +1324,3900 @@ void init(GLFWwindow *window, int width, int height, float camera_offset, const
     app.point_size_attrib = 5;
 
     initializeScene(scene_filename, app);
+    if (app.views.enabled)
+    {
+        // every point is instanced once per view (see equirect_color.vert)
+        glBindVertexArray(app.scene.model.vertex_array);
+        glVertexAttribDivisor(app.point_center_attrib, app.views.count);
+        glVertexAttribDivisor(app.point_color_attrib, app.views.count);
+        glVertexAttribDivisor(app.point_size_attrib, app.views.count);
+        glBindVertexArray(0);
+        if (app.views.layered)
+        {
+            std::cout << "Rendering " << app.views.count << " views into array layers" << std::endl;
+        }
+        else
+        {
+            std::cout << "Rendering " << app.views.count << " views into a " << app.views.columns << "x" << app.views.rows << " atlas" << std::endl;
+        }
+    }
 
     loadShader("resrc/shaders/equirect_color", app);
+    if (app.renderer == RENDERER_COMPUTE)
+    {
+        initializePointSplat(app);
+    }
+    else if (app.renderer == RENDERER_CUBEMAP)
+    {
+        initializeCubemap(app);
+    }
+    else if (app.renderer == RENDERER_SLICES)
+    {
+        initializeSlices(app);
+    }
+    else if (app.geometry_capture.enabled)
+    {
+        initializeGeometryCapture(app);
+    }
+    if (app.stereo == STEREO_SYNTHESIZED)
+    {
+        initializeEyeSynthesis(app);
+    }
+    if (app.render_layout.layout != LAYOUT_EQUIRECT)
+    {
+        initializeRenderLayout(app);
+    }
+    memset(app.variant_chunk_counts, 0, sizeof(app.variant_chunk_counts));
+    if (app.conversion.enabled)
+    {
+        initializeFrameConversion(app);
+    }
+    if (!app.pyramid.levels.empty())
+    {
+        initializeOutputPyramid(app);
+    }
+    if (app.delta.enabled)
+    {
+        initializeTileDelta(app);
+    }
+    if (app.readback.ring_size > 0)
+    {
+        initializeFrameReadback(app);
+    }
+    if (app.frame_ring.enabled)
+    {
+        initializeSharedFrameRing(app);
+    }
+    if (app.preview.enabled)
+    {
+        initializePreviewServer(app);
+    }
+
+    initializeUniforms(camera_offset, app);
+}
+
+void initializeScene(const char *scene_filename, App &app)
+{
+    const int NONE = -1;
+    const int CAMERA = 0;
+    const int LIGHTS = 1;
+    const int POINTS = 2;
+
+    std::cout << "Reading scene file" << std::endl;
+    app.scene.version = 0;
+
+    std::ifstream scene_file(scene_filename);
+    std::string line;
+    int section = NONE;
+    int light_count, point_count, light_idx = 0, point_idx = 0;
+    GLfloat *point_centers, *point_colors, *point_sizes;
+    float x, y, z, size, red, green, blue;
+    int skip = 1; // 1 out ouf every `skip` points will be rendered
+    while (std::getline(scene_file, line))
+    {
+        // start of camera data
+        if (line.length() > 0 && line[0] == 'c')
+        {
+            section = CAMERA;
+        }
+        // start of lights data
+        else if (line.length() > 0 && line[0] == 'l')
+        {
+            std::istringstream iss(line);
+            std::string name;
+            iss >> name >> light_count;
+            app.scene.ambient_light = glm::vec3(0.25, 0.25, 0.25);
+            app.scene.num_lights = light_count;
+            app.scene.light_positions = new GLfloat[3 * app.scene.num_lights];
+            app.scene.light_colors = new GLfloat[3 * app.scene.num_lights];
+            section = LIGHTS;
+        }
+        // start of points data
+        else if (line.length() > 0 && line[0] == 'p')
+        {
+            std::istringstream iss(line);
+            std::string name;
+            iss >> name >> point_count;
+            app.scene.num_points = (point_count - 1) / skip + 1;
+            point_centers = new GLfloat[3 * app.scene.num_points];
+            point_colors = new GLfloat[3 * app.scene.num_points];
+            point_sizes = new GLfloat[app.scene.num_points];
+            section = POINTS;
+        }
+        // camera data
+        else if (line.length() > 0 && line[0] != '#' && section == CAMERA)
+        {
+            std::istringstream iss(line);
+            iss >> x >> y >> z;
+            app.scene.camera_pos = glm::vec3(x, y, z);
+        }
+        // light data
+        else if (line.length() > 0 && line[0] != '#' && section == LIGHTS)
+        {
+            std::istringstream iss(line);
+            iss >> x >> y >> z >> red >> green >> blue;
+            app.scene.light_positions[3 * light_idx] = x;
+            app.scene.light_positions[3 * light_idx + 1] = y;
+            app.scene.light_positions[3 * light_idx + 2] = z;
+            app.scene.light_colors[3 * light_idx] = red;
+            app.scene.light_colors[3 * light_idx + 1] = green;
+            app.scene.light_colors[3 * light_idx + 2] = blue;
+            light_idx++;
+        }
+        // point data
+        else if (line.length() > 0 && line[0] != '#' && section == POINTS)
+        {
+            std::istringstream iss(line);
+            iss >> x >> y >> z >> size >> red >> green >> blue;
+            
+            if (point_idx % skip == 0)
+            {
+                //if (point_idx >= app.scene.num_points) std::cout << "Oops - exceeded point count" << std::endl;
+                point_centers[3 * (point_idx / skip)] = x;
+                point_centers[3 * (point_idx / skip) + 1] = y;
+                point_centers[3 * (point_idx / skip) + 2] = z;
+                point_sizes[point_idx / skip] = size;
+                point_colors[3 * (point_idx / skip)] = red;
+                point_colors[3 * (point_idx / skip) + 1] = green;
+                point_colors[3 * (point_idx / skip) + 2] = blue;
+            }
+            point_idx++;
+        }
+    }
+    std::cout << point_idx / skip << "/" << app.scene.num_points << std::endl;
+    createPointChunks(point_centers, point_colors, point_sizes, app.scene.num_points, app.scene.chunks);
+    GLuint point_buffers[3];
+    app.scene.model.vertex_array = createPointCloudVao(point_centers, point_colors, point_sizes, app.scene.num_points, app.vertex_position_attrib,
+        app.vertex_normal_attrib, app.vertex_texcoord_attrib, app.point_center_attrib, app.point_color_attrib, app.point_size_attrib, &(app.scene.model.face_index_count),
+        point_buffers);
+    app.scene.model.point_center_buffer = point_buffers[0];
+    app.scene.model.point_color_buffer = point_buffers[1];
+    app.scene.model.point_size_buffer = point_buffers[2];
+    app.scene.version++;
+    delete[] point_centers;
+    delete[] point_colors;
+    delete[] point_sizes;
+
+    std::cout << "Finished" << std::endl;
+
+    /*
+    glm::vec3 camera_move_direction = glm::vec3(0.98348, -0.03766, 0.17702);
+    app.scene.camera_pos = app.scene.camera_pos - (-75.0f * camera_move_direction);
+
+    glm::vec3 f265 = app.scene.camera_pos + ((-0.2f * 265.0f) * camera_move_direction);
+    printf("frame 265 location: %.4f, %.4f, %.4f\n", f265[0], f265[1], f265[2]);
+    // frame 265
+    // move (260.6222, -9.9799, 46.9103)
+
+    app.scene.camera_pos = app.scene.camera_pos + ((-0.2f * 264.0f) * camera_move_direction);
+    */
+}
+
+void initializeUniforms(float camera_offset, App &app)
+{
+    // Synthesized stereo renders the left eye and warps it to the right eye
+    app.camera_offset = (app.stereo == STEREO_SYNTHESIZED) ? -fabs(camera_offset) : camera_offset;
+
+    // Shader permutations pick up scene uniforms when first used (see `useEquirectProgram`)
+    app.uniforms_version = 1;
+
+    glUseProgram(app.program);
+    setSceneUniforms(app.uniforms, app);
+    glUniform2f(uniformLocation(app.uniforms, "framebuffer_size"), app.framebuffer_width, app.framebuffer_height);
+    glUniform1f(uniformLocation(app.uniforms, "tess_edge_pixels"), app.tess_edge_pixels);
+
+    if (app.renderer == RENDERER_COMPUTE)
+    {
+        glUseProgram(app.splat_program.program);
+        setSceneUniforms(app.splat_program.uniforms, app);
+        glUniform1ui(uniformLocation(app.splat_program.uniforms, "num_points"), app.scene.num_points);
+        glUniform2i(uniformLocation(app.splat_program.uniforms, "image_size"), app.framebuffer_width, app.framebuffer_height);
+    }
+    else if (app.geometry_capture.enabled)
+    {
+        glUseProgram(app.geometry_capture.replay_program.program);
+        setSceneUniforms(app.geometry_capture.replay_program.uniforms, app);
+    }
+
+    glUseProgram(0);
+}
+
+void setSceneUniforms(std::map<std::string, GLint> &uniforms, App &app)
+{
+    // Lights and camera (program must already be in use)
+    // (specialized permutations may have optimized some of these away)
+    glUniform1i(uniformLocation(uniforms, "num_lights"), app.scene.num_lights);
+    glUniform3fv(uniformLocation(uniforms, "light_ambient"), 1, glm::value_ptr(app.scene.ambient_light));
+    glUniform3fv(uniformLocation(uniforms, "light_position[0]"), app.scene.num_lights, app.scene.light_positions);
+    glUniform3fv(uniformLocation(uniforms, "light_color[0]"), app.scene.num_lights, app.scene.light_colors);
+    glUniform3fv(uniformLocation(uniforms, "camera_position"), 1, glm::value_ptr(app.scene.camera_pos));
+    glUniform1f(uniformLocation(uniforms, "camera_offset"), app.camera_offset);
+}
+
+void initializePointSplat(App &app)
+{
+    // Compute shader that projects and splats every point, and fullscreen pass that resolves the splats
+    loadProgram("resrc/shaders/point_splat", app.splat_program, app);
+    loadProgram("resrc/shaders/point_resolve", app.resolve_program, app);
+
+    // Nearest distance per pixel (float bits stored as uint so it can be resolved with `imageAtomicMin`)
+    int i;
+    uint32_t *far_depth = new uint32_t[app.framebuffer_width * app.framebuffer_height];
+    for (i = 0; i < app.framebuffer_width * app.framebuffer_height; i++)
+    {
+        far_depth[i] = 0xFFFFFFFF;
+    }
+    glGenTextures(1, &(app.splat_depth_texture));
+    glBindTexture(GL_TEXTURE_2D, app.splat_depth_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, app.framebuffer_width, app.framebuffer_height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, far_depth);
+    delete[] far_depth;
+
+    // Color of the nearest point per pixel
+    glGenTextures(1, &(app.splat_color_texture));
+    glBindTexture(GL_TEXTURE_2D, app.splat_color_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, app.framebuffer_width, app.framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GlslProgram& getProgram(std::string shader_filename_base, std::vector<std::string> defines, App &app)
+{
+    // Permutations are keyed by base name and sorted defines, and compiled the first time they are requested
+    std::sort(defines.begin(), defines.end());
+    std::string key = shader_filename_base;
+    size_t i;
+    for (i = 0; i < defines.size(); i++)
+    {
+        key += "|" + defines[i];
+    }
+
+    std::map<std::string, GlslProgram>::iterator it = app.program_cache.find(key);
+    if (it != app.program_cache.end())
+    {
+        return it->second;
+    }
+
+    GlslProgram &glsl_program = app.program_cache[key];
+    loadProgram(shader_filename_base, glsl_program, app, defines);
+    std::cout << "Compiled shader permutation: " << key << std::endl;
+    return glsl_program;
+}
+
+void useEquirectProgram(int variant, App &app)
+{
+    // Geometry shader variant omits pole and/or seam handling, specialization bakes in
+    // values that stay constant for the whole run (light count, mono camera)
+    std::vector<std::string> defines;
+    if (variant & VARIANT_NO_POLE) defines.push_back("NO_POLE");
+    if (variant & VARIANT_NO_SEAM) defines.push_back("NO_SEAM");
+    if (app.stereo == STEREO_OVER_UNDER || app.stereo == STEREO_LAYERED) defines.push_back("STEREO");
+    if (app.stereo == STEREO_LAYERED) defines.push_back("STEREO_LAYERED");
+    if (app.render_layout.layout == LAYOUT_EQUAL_AREA) defines.push_back("EQUAL_AREA");
+    if (app.partial_output) defines.push_back("OUTPUT_BOUNDS");
+    if (app.projection == PROJECTION_DOMEMASTER) defines.push_back("PROJECTION_DOMEMASTER");
+    if (app.projection == PROJECTION_CYLINDRICAL) defines.push_back("PROJECTION_CYLINDRICAL");
+    if (app.views.enabled) defines.push_back("VIEWS " + std::to_string(app.views.count));
+    if (app.views.enabled && app.views.layered) defines.push_back("VIEWS_LAYERED");
+    if (app.distance_output) defines.push_back("DISTANCE_OUTPUT");
+    if (app.specialize_shaders)
+    {
+        defines.push_back("NUM_LIGHTS " + std::to_string(app.scene.num_lights));
+        if (app.camera_offset == 0.0f && app.stereo == STEREO_NONE && !app.views.enabled) defines.push_back("MONO");
+    }
+    GlslProgram &glsl_program = getProgram("resrc/shaders/equirect_color", defines, app);
+
+    // Bring uniforms up to date if they changed since this permutation was last used
+    glUseProgram(glsl_program.program);
+    if (glsl_program.uniforms_version != app.uniforms_version)
+    {
+        setSceneUniforms(glsl_program.uniforms, app);
+        bool internal_layout = app.render_layout.layout != LAYOUT_EQUIRECT;
+        glUniform2f(uniformLocation(glsl_program.uniforms, "framebuffer_size"), internal_layout ? app.render_layout.width : app.framebuffer_width,
+                    internal_layout ? app.render_layout.height : app.framebuffer_height);
+        glUniform1f(uniformLocation(glsl_program.uniforms, "tess_edge_pixels"), app.tess_edge_pixels);
+        if (app.partial_output)
+        {
+            // Longitude / latitude bounds map to the viewport (depth range matches equirect_color.geom)
+            glm::mat4 ortho_projection = glm::ortho(app.output_bounds.x, app.output_bounds.y, app.output_bounds.z, app.output_bounds.w, 0.01f, 500.0f);
+            glUniformMatrix4fv(uniformLocation(glsl_program.uniforms, "ortho_projection"), 1, GL_FALSE, glm::value_ptr(ortho_projection));
+            glUniform4fv(uniformLocation(glsl_program.uniforms, "output_bounds"), 1, glm::value_ptr(app.output_bounds));
+        }
+        glUniform1f(uniformLocation(glsl_program.uniforms, "projection_fov"), app.projection_fov);
+        if (app.views.enabled)
+        {
+            // views follow the scene camera
+            std::vector<glm::vec3> view_positions(app.views.count);
+            int i;
+            for (i = 0; i < app.views.count; i++)
+            {
+                view_positions[i] = app.scene.camera_pos + app.views.positions[i];
+            }
+            glUniform3fv(uniformLocation(glsl_program.uniforms, "view_camera_position[0]"), app.views.count, glm::value_ptr(view_positions[0]));
+            glUniform1fv(uniformLocation(glsl_program.uniforms, "view_camera_offset[0]"), app.views.count, app.views.offsets.data());
+        }
+        glsl_program.uniforms_version = app.uniforms_version;
+    }
+}
+
+void createPointChunks(GLfloat *point_centers, GLfloat *point_colors, GLfloat *point_sizes, uint32_t num_points, std::vector<PointChunk> &chunks)
+{
+    // Sort points along a Morton curve so consecutive points are spatially close
+    glm::vec3 min_coord = glm::vec3(9.9e12, 9.9e12, 9.9e12);
+    glm::vec3 max_coord = glm::vec3(-9.9e12, -9.9e12, -9.9e12);
+    uint32_t i, j, k;
+    for (i = 0; i < num_points; i++)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            min_coord[k] = std::min(min_coord[k], point_centers[3 * i + k]);
+            max_coord[k] = std::max(max_coord[k], point_centers[3 * i + k]);
+        }
+    }
+    glm::vec3 extent = max_coord - min_coord;
+    std::vector<std::pair<uint32_t, uint32_t> > order(num_points);
+    for (i = 0; i < num_points; i++)
+    {
+        uint32_t code = 0;
+        for (k = 0; k < 3; k++)
+        {
+            uint32_t cell = (extent[k] > 0.0f) ? (uint32_t)(1023.0f * (point_centers[3 * i + k] - min_coord[k]) / extent[k]) : 0;
+            for (j = 0; j < 10; j++)
+            {
+                code |= ((cell >> j) & 1) << (3 * j + k);
+            }
+        }
+        order[i] = std::make_pair(code, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    GLfloat *sorted_centers = new GLfloat[3 * num_points];
+    GLfloat *sorted_colors = new GLfloat[3 * num_points];
+    GLfloat *sorted_sizes = new GLfloat[num_points];
+    for (i = 0; i < num_points; i++)
+    {
+        uint32_t idx = order[i].second;
+        for (k = 0; k < 3; k++)
+        {
+            sorted_centers[3 * i + k] = point_centers[3 * idx + k];
+            sorted_colors[3 * i + k] = point_colors[3 * idx + k];
+        }
+        sorted_sizes[i] = point_sizes[idx];
+    }
+    memcpy(point_centers, sorted_centers, 3 * num_points * sizeof(GLfloat));
+    memcpy(point_colors, sorted_colors, 3 * num_points * sizeof(GLfloat));
+    memcpy(point_sizes, sorted_sizes, num_points * sizeof(GLfloat));
+    delete[] sorted_centers;
+    delete[] sorted_colors;
+    delete[] sorted_sizes;
+
+    // Bounding sphere per chunk (billboards extend at most `point_size` from their center)
+    chunks.clear();
+    for (i = 0; i < num_points; i += POINT_CHUNK_SIZE)
+    {
+        PointChunk chunk;
+        chunk.first_point = i;
+        chunk.num_points = std::min((uint32_t)POINT_CHUNK_SIZE, num_points - i);
+        glm::vec3 chunk_min = glm::vec3(9.9e12, 9.9e12, 9.9e12);
+        glm::vec3 chunk_max = glm::vec3(-9.9e12, -9.9e12, -9.9e12);
+        for (j = i; j < i + chunk.num_points; j++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                chunk_min[k] = std::min(chunk_min[k], point_centers[3 * j + k]);
+                chunk_max[k] = std::max(chunk_max[k], point_centers[3 * j + k]);
+            }
+        }
+        chunk.center = 0.5f * (chunk_min + chunk_max);
+        chunk.radius = 0.0f;
+        for (j = i; j < i + chunk.num_points; j++)
+        {
+            glm::vec3 center = glm::vec3(point_centers[3 * j], point_centers[3 * j + 1], point_centers[3 * j + 2]);
+            chunk.radius = std::max(chunk.radius, glm::length(center - chunk.center) + point_sizes[j]);
+        }
+        chunks.push_back(chunk);
+    }
+}
+
+int classifyPointChunk(PointChunk &chunk, App &app)
+{
+    // Eye positions lie within `camera_offset` of the camera in the horizontal plane
+    // (a batch of views only gets the variant every one of its cameras allows)
+    float margin = chunk.radius + fabs(app.camera_offset);
+    int variant = VARIANT_NO_POLE | VARIANT_NO_SEAM;
+    int num_views = app.views.enabled ? app.views.count : 1;
+    int i;
+    for (i = 0; i < num_views; i++)
+    {
+        glm::vec3 camera_position = app.scene.camera_pos;
+        float view_margin = margin;
+        if (app.views.enabled)
+        {
+            camera_position += app.views.positions[i];
+            view_margin = chunk.radius + fabs(app.views.offsets[i]);
+        }
+        float dx = chunk.center.x - camera_position.x;
+        float dz = chunk.center.z - camera_position.z;
+
+        // Pole axis is the vertical line through the camera
+        if (dx * dx + dz * dz <= view_margin * view_margin)
+        {
+            variant = 0;
+        }
+        // Seam is the vertical half-plane behind the camera (x = 0, z < 0 relative to the camera)
+        else if (fabs(dx) <= view_margin && dz <= view_margin)
+        {
+            variant &= ~VARIANT_NO_SEAM;
+        }
+    }
+
+    // Chunk cannot reach the output bounds (same test as equirect_color.vert does per point)
+    if (app.partial_output)
+    {
+        glm::vec3 direction = chunk.center - app.scene.camera_pos;
+        float distance = glm::length(direction);
+        if (distance > margin)
+        {
+            float angular_radius = asin(margin / distance);
+            float latitude = asin(direction.y / distance);
+            float longitude = -atan2(direction.x, direction.z);
+            bool outside = (latitude - angular_radius > app.output_bounds.w) || (latitude + angular_radius < app.output_bounds.z);
+            if (fabs(latitude) + angular_radius < 0.5 * M_PI)
+            {
+                float longitude_radius = asin(std::min(sin(angular_radius) / cos(latitude), 1.0f));
+                float delta = longitude - 0.5f * (app.output_bounds.x + app.output_bounds.y);
+                delta = fabs(delta - 2.0 * M_PI * floor((delta + M_PI) / (2.0 * M_PI)));
+                outside = outside || (delta - longitude_radius > 0.5f * (app.output_bounds.y - app.output_bounds.x));
+            }
+            if (outside)
+            {
+                variant = VARIANT_CULLED;
+            }
+        }
+    }
+    return variant;
+}
+
+void initializeGeometryCapture(App &app)
+{
+    GeometryCapture &capture = app.geometry_capture;
+
+    // Relink main program so geometry shader output is written to the feedback buffer
+    std::vector<std::string> varyings;
+    varyings.push_back("gl_Position");
+    varyings.push_back("world_position");
+    varyings.push_back("world_normal");
+    varyings.push_back("model_texcoord");
+    varyings.push_back("model_color");
+    varyings.push_back("model_center");
+    GlslProgram capture_program;
+    std::vector<std::string> capture_filenames;
+    capture_filenames.push_back("resrc/shaders/equirect_color.vert");
+    capture_filenames.push_back("resrc/shaders/equirect_color.tesc");
+    capture_filenames.push_back("resrc/shaders/equirect_color.tese");
+    capture_filenames.push_back("resrc/shaders/equirect_color.geom");
+    capture_filenames.push_back("resrc/shaders/equirect_color.frag");
+    loadProgramFiles(capture_filenames, capture_program, app, std::vector<std::string>(), varyings);
+    glDeleteProgram(app.program);
+    app.program = capture_program.program;
+    app.uniforms = capture_program.uniforms;
+
+    // Pass-through program that replays captured triangles with the regular fragment shader
+    std::vector<std::string> replay_filenames;
+    replay_filenames.push_back("resrc/shaders/equirect_replay.vert");
+    replay_filenames.push_back("resrc/shaders/equirect_color.frag");
+    loadProgramFiles(replay_filenames, capture.replay_program, app);
+
+    // Feedback buffer (grows on demand) - interleaved vec4 position, vec3 world position, vec3 world normal,
+    // vec2 texcoord, vec3 color, vec3 center
+    GLsizei stride = 18 * sizeof(GLfloat);
+    capture.capacity = 16 * app.scene.num_points;
+    capture.num_triangles = 0;
+    glGenBuffers(1, &(capture.buffer));
+    glBindBuffer(GL_ARRAY_BUFFER, capture.buffer);
+    glBufferData(GL_ARRAY_BUFFER, 3 * capture.capacity * stride, NULL, GL_STATIC_COPY);
+
+    glGenTransformFeedbacks(1, &(capture.feedback));
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, capture.feedback);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, capture.buffer);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+    // Replay VAO reads the captured vertices (attribute locations are fixed in equirect_replay.vert)
+    glGenVertexArrays(1, &(capture.vertex_array));
+    glBindVertexArray(capture.vertex_array);
+    GLint sizes[6] = {4, 3, 3, 2, 3, 3};
+    int i, offset = 0;
+    for (i = 0; i < 6; i++)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, sizes[i], GL_FLOAT, false, stride, (void*)(offset * sizeof(GLfloat)));
+        offset += sizes[i];
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenQueries(1, &(capture.primitives_query));
+    capture.valid = false;
+}
+
+void initializeEyeSynthesis(App &app)
+{
+    EyeSynthesis &synthesis = app.eye_synthesis;
+
+    // Warp rendered eye along its triangulated pixel grid plus one point per pixel (for objects that
+    // are too small to keep any triangle), then fill disoccluded holes
+    loadProgram("resrc/shaders/eye_warp", synthesis.warp_program, app);
+    std::vector<std::string> splat_filenames;
+    splat_filenames.push_back("resrc/shaders/eye_warp.vert");
+    splat_filenames.push_back("resrc/shaders/eye_splat.frag");
+    loadProgramFiles(splat_filenames, synthesis.splat_program, app);
+    loadProgram("resrc/shaders/eye_fill", synthesis.fill_program, app);
+
+    // Target 0 holds the rendered eye, target 1 the warped eye (depth textures store linear distance,
+    // see `gl_FragDepth` in equirect_color.frag)
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        GLint filter = (i == 0) ? GL_LINEAR : GL_NEAREST;
+        glGenTextures(1, &(synthesis.color_textures[i]));
+        glBindTexture(GL_TEXTURE_2D, synthesis.color_textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, app.framebuffer_width, app.framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        glGenTextures(1, &(synthesis.depth_textures[i]));
+        glBindTexture(GL_TEXTURE_2D, synthesis.depth_textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, app.framebuffer_width, app.framebuffer_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &(synthesis.framebuffers[i]));
+        glBindFramebuffer(GL_FRAMEBUFFER, synthesis.framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, synthesis.color_textures[i], 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, synthesis.depth_textures[i], 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void initializeCubemap(App &app)
+{
+    CubemapRenderer &cubemap = app.cubemap;
+
+    // Faces are drawn with the regular billboard fragment shader behind a plain perspective vertex shader
+    std::vector<std::string> face_filenames;
+    face_filenames.push_back("resrc/shaders/cube_color.vert");
+    face_filenames.push_back("resrc/shaders/equirect_color.frag");
+    std::vector<std::string> defines;
+    defines.push_back("MONO");
+    if (app.specialize_shaders) defines.push_back("NUM_LIGHTS " + std::to_string(app.scene.num_lights));
+    loadProgramFiles(face_filenames, cubemap.face_program, app, defines);
+    loadProgram("resrc/shaders/cube_resample", cubemap.resample_program, app);
+
+    glGenTextures(1, &(cubemap.texture));
+    glGenRenderbuffers(1, &(cubemap.depth_renderbuffer));
+    glGenFramebuffers(1, &(cubemap.framebuffer));
+    cubemap.face_size = 0;
+    resizeCubemap(app);
+
+    // Filter across face edges when resampling
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+}
+
+void resizeCubemap(App &app)
+{
+    // Default face size matches the equirect pixel density at the center of each face
+    CubemapRenderer &cubemap = app.cubemap;
+    int face_size = (cubemap.requested_face_size > 0) ? cubemap.requested_face_size : std::max(app.framebuffer_width / 4, 1);
+    if (face_size == cubemap.face_size)
+    {
+        return;
+    }
+    cubemap.face_size = face_size;
+
+    int i;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap.texture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    for (i = 0; i < 6; i++)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA8, face_size, face_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    // Depth is shared by all faces (cleared before each one)
+    glBindRenderbuffer(GL_RENDERBUFFER, cubemap.depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, face_size, face_size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+void initializeSlices(App &app)
+{
+    SliceRenderer &slices = app.slices;
+
+    // Billboards and shading are shared with the tessellation pipeline, only the projection differs
+    std::vector<std::string> draw_filenames;
+    draw_filenames.push_back("resrc/shaders/equirect_color.vert");
+    draw_filenames.push_back("resrc/shaders/ods_slice.geom");
+    draw_filenames.push_back("resrc/shaders/equirect_color.frag");
+    std::vector<std::string> defines;
+    defines.push_back("SLICE_BATCH " + std::to_string(SLICE_BATCH));
+    if (app.specialize_shaders) defines.push_back("NUM_LIGHTS " + std::to_string(app.scene.num_lights));
+    loadProgramFiles(draw_filenames, slices.draw_program, app, defines);
+    std::vector<std::string> resample_filenames;
+    resample_filenames.push_back("resrc/shaders/cube_resample.vert");
+    resample_filenames.push_back("resrc/shaders/ods_slice_resample.frag");
+    loadProgramFiles(resample_filenames, slices.resample_program, app);
+
+    glGenTextures(1, &(slices.color_texture));
+    glGenTextures(1, &(slices.depth_texture));
+    glGenFramebuffers(1, &(slices.framebuffer));
+    resizeSlices(app);
+}
+
+void resizeSlices(App &app)
+{
+    SliceRenderer &slices = app.slices;
+    int num_cells = slices.slice_count * slices.row_count;
+    GLint max_layers;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    if (num_cells > max_layers)
+    {
+        std::cerr << "Error: " << num_cells << " slices exceed the maximum of " << max_layers << " array texture layers" << std::endl;
+        exit(1);
+    }
+
+    // Frustum of each row: tightest bounds around the boundary of its lon/lat cell (every column is the
+    // same cell rotated about +y), expanded by one texel on each side for bilinear filtering
+    float slice_width = 2.0 * M_PI / slices.slice_count;
+    float row_height = M_PI / slices.row_count;
+    int i, j;
+    slices.row_bounds.resize(slices.row_count);
+    slices.cell_width = 1;
+    slices.cell_height = 1;
+    for (i = 0; i < slices.row_count; i++)
+    {
+        float center_latitude = (i + 0.5) * row_height - 0.5 * M_PI;
+        glm::vec3 forward = glm::vec3(0.0, sin(center_latitude), cos(center_latitude));
+        glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0, 1.0, 0.0)));
+        glm::vec3 up = glm::cross(right, forward);
+        glm::vec4 bounds = glm::vec4(1.0e6, -1.0e6, 1.0e6, -1.0e6);
+        for (j = 0; j <= 64; j++)
+        {
+            float t = j / 64.0;
+            float edge_longitudes[4] = {(t - 0.5f) * slice_width, (t - 0.5f) * slice_width, -0.5f * slice_width, 0.5f * slice_width};
+            float edge_latitudes[4] = {center_latitude - 0.5f * row_height, center_latitude + 0.5f * row_height,
+                                       center_latitude + (t - 0.5f) * row_height, center_latitude + (t - 0.5f) * row_height};
+            int k;
+            for (k = 0; k < 4; k++)
+            {
+                glm::vec3 direction = glm::vec3(-sin(edge_longitudes[k]) * cos(edge_latitudes[k]), sin(edge_latitudes[k]),
+                                                cos(edge_longitudes[k]) * cos(edge_latitudes[k]));
+                float x = glm::dot(direction, right) / glm::dot(direction, forward);
+                float y = glm::dot(direction, up) / glm::dot(direction, forward);
+                bounds = glm::vec4(std::min(bounds.x, x), std::max(bounds.y, x), std::min(bounds.z, y), std::max(bounds.w, y));
+            }
+        }
+        slices.row_bounds[i] = bounds;
+
+        // Match the equirect pixel density at the center of the cell
+        slices.cell_width = std::max(slices.cell_width, (int)ceil((bounds.y - bounds.x) * app.framebuffer_width / (2.0 * M_PI)) + 2);
+        slices.cell_height = std::max(slices.cell_height, (int)ceil((bounds.w - bounds.z) * app.framebuffer_height / M_PI) + 2);
+    }
+    for (i = 0; i < slices.row_count; i++)
+    {
+        glm::vec4 &bounds = slices.row_bounds[i];
+        float texel_x = (bounds.y - bounds.x) / (slices.cell_width - 2);
+        float texel_y = (bounds.w - bounds.z) / (slices.cell_height - 2);
+        bounds = glm::vec4(bounds.x - texel_x, bounds.y + texel_x, bounds.z - texel_y, bounds.w + texel_y);
+    }
+
+    // One array layer per cell (column major, so a batch of consecutive cells spans a longitude range)
+    glBindTexture(GL_TEXTURE_2D_ARRAY, slices.color_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, slices.cell_width, slices.cell_height, num_cells, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, slices.depth_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, slices.cell_width, slices.cell_height, num_cells, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    GLint framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, slices.framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, slices.color_texture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, slices.depth_texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // Cameras are rebuilt on the next render
+    slices.draw_program.uniforms_version = 0;
+}
+
+void initializeRenderLayout(App &app)
+{
+    RenderLayout &render_layout = app.render_layout;
+    std::vector<std::string> resample_filenames;
+    resample_filenames.push_back("resrc/shaders/cube_resample.vert");
+    resample_filenames.push_back("resrc/shaders/layout_resample.frag");
+    loadProgramFiles(resample_filenames, render_layout.resample_program, app);
+
+    glGenTextures(1, &(render_layout.texture));
+    glGenRenderbuffers(1, &(render_layout.depth_renderbuffer));
+    glGenFramebuffers(1, &(render_layout.framebuffer));
+    render_layout.width = 0;
+    render_layout.height = 0;
+    resizeRenderLayout(app);
+}
+
+void resizeRenderLayout(App &app)
+{
+    // Equal-area rows are spaced by sin(latitude): same row density as the equirect at the equator,
+    // 2 / pi as many rows in total (the polar rows of the equirect are mostly redundant)
+    RenderLayout &render_layout = app.render_layout;
+    int width = app.framebuffer_width;
+    int height = std::max((int)(app.framebuffer_height * 2.0 / M_PI + 0.5), 1);
+    if (width == render_layout.width && height == render_layout.height)
+    {
+        return;
+    }
+    render_layout.width = width;
+    render_layout.height = height;
+
+    glBindTexture(GL_TEXTURE_2D, render_layout.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, render_layout.depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, render_layout.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, render_layout.texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, render_layout.depth_renderbuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // Tessellation levels depend on the layout size
+    app.uniforms_version++;
+}
+
+void parseViews(std::string views, float camera_offset, ViewBatch &batch)
+{
+    // Views are `dx,dy,dz[,offset]` relative to the scene camera (offset defaults to the command line camera offset),
+    // separated by `;` or given one per line in a file
+    if (fileExists(views.c_str()))
+    {
+        char *data;
+        int32_t length = readFile(views.c_str(), &data);
+        if (length < 0)
+        {
+            exit(1);
+        }
+        views = std::string(data, length);
+        free(data);
+        std::replace(views.begin(), views.end(), '\n', ';');
+    }
+
+    batch.positions.clear();
+    batch.offsets.clear();
+    size_t start = 0;
+    while (start <= views.length())
+    {
+        size_t end = views.find(';', start);
+        if (end == std::string::npos)
+        {
+            end = views.length();
+        }
+        std::string view = views.substr(start, end - start);
+        start = end + 1;
+        if (view.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        glm::vec3 position;
+        float offset = camera_offset;
+        int num_values = sscanf(view.c_str(), "%f,%f,%f,%f", &position.x, &position.y, &position.z, &offset);
+        if (num_values != 3 && num_values != 4)
+        {
+            std::cerr << "Error: cannot parse view '" << view << "' (expected `dx,dy,dz[,offset]`)" << std::endl;
+            exit(1);
+        }
+        batch.positions.push_back(position);
+        batch.offsets.push_back(offset);
+    }
+    batch.count = batch.positions.size();
+    if (batch.count < 1 || batch.count > MAX_VIEWS)
+    {
+        std::cerr << "Error: view batches need 1 to " << MAX_VIEWS << " views" << std::endl;
+        exit(1);
+    }
+}
+
+void updateSliceCameras(App &app)
+{
+    SliceRenderer &slices = app.slices;
+    float slice_width = 2.0 * M_PI / slices.slice_count;
+    float row_height = M_PI / slices.row_count;
+    glm::vec3 world_up = glm::vec3(0.0, 1.0, 0.0);
+    int i, j;
+    slices.view_projections.resize(slices.slice_count * slices.row_count);
+    for (i = 0; i < slices.slice_count; i++)
+    {
+        float center_longitude = (i + 0.5) * slice_width - M_PI;
+        glm::vec3 horizontal_forward = glm::vec3(-sin(center_longitude), 0.0, cos(center_longitude));
+        glm::vec3 right = glm::normalize(glm::cross(horizontal_forward, world_up));
+        for (j = 0; j < slices.row_count; j++)
+        {
+            float center_latitude = (j + 0.5) * row_height - 0.5 * M_PI;
+            glm::vec3 forward = glm::vec3(-sin(center_longitude) * cos(center_latitude), sin(center_latitude),
+                                          cos(center_longitude) * cos(center_latitude));
+
+            // Whole slice shares the eye of its center direction (same ocular offset falloff towards the
+            // poles as `projectVertex()` in equirect_color.geom)
+            float inclination = fabs(center_latitude) / M_PI;
+            float adjust_coeff = std::min(std::max((inclination - (0.5f - 1.0f / 12.0f)) / (1.0f / 12.0f), 0.0f), 1.0f);
+            glm::vec3 eye = app.scene.camera_pos + ((1.0f - adjust_coeff) * app.camera_offset) * right;
+
+            glm::vec4 &bounds = slices.row_bounds[j];
+            glm::mat4 projection = glm::frustum(0.01f * bounds.x, 0.01f * bounds.y, 0.01f * bounds.z, 0.01f * bounds.w, 0.01f, 1000.0f);
+            slices.view_projections[i * slices.row_count + j] = projection * glm::lookAt(eye, eye + forward, world_up);
+        }
+    }
+}
+
+void idle(GLFWwindow *window, App &app)
+{
+    // update camera
+    //glm::vec3 camera_move_direction = glm::vec3(0.98348, -0.03766, 0.17702);
+    //app.scene.camera_pos = app.scene.camera_pos + (-0.2f * camera_move_direction);
+    //glUseProgram(app.program);
+    //glUniform3fv(app.uniforms["camera_position"], 1, glm::value_ptr(app.scene.camera_pos));
+    //glUseProgram(0);
+
+    render(window, app);
+}
+
+void render(GLFWwindow *window, App &app)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+
+    // Delete previous frame (reset both framebuffer and z-buffer)
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (app.distance_output)
+    {
+        // background is infinitely far away
+        const GLfloat no_distance[4] = {INFINITY, 0.0f, 0.0f, 0.0f};
+        glClearBufferfv(GL_COLOR, 1, no_distance);
+    }
+
+    renderScene(app);
+
+    glfwSwapBuffers(window);
+}
+
+void renderScene(App &app)
+{
+    // Draw into the currently bound framebuffer with the selected renderer
+    if (app.renderer == RENDERER_COMPUTE)
+    {
+        renderPointSplat(app);
+    }
+    else if (app.renderer == RENDERER_CUBEMAP)
+    {
+        renderCubemap(app);
+    }
+    else if (app.renderer == RENDERER_SLICES)
+    {
+        renderSlices(app);
+    }
+    else if (app.geometry_capture.enabled)
+    {
+        renderCapturedGeometry(app);
+    }
+    else if (app.stereo == STEREO_SYNTHESIZED)
+    {
+        renderSynthesizedStereo(app);
+    }
+    else if (app.render_layout.layout == LAYOUT_EQUAL_AREA)
+    {
+        renderEqualAreaLayout(app);
+    }
+    else
+    {
+        renderTessellatedPoints(app);
+    }
+}
+
+void renderTessellatedPoints(App &app)
+{
+    if (!app.classify_chunks)
+    {
+        // Select shader program to use
+        useEquirectProgram(0, app);
+
+        // Render
+        glBindVertexArray(app.scene.model.vertex_array);
+        glPatchParameteri(GL_PATCH_VERTICES, 3);
+        int num_views = app.views.enabled ? app.views.count : 1;
+        glDrawElementsInstanced(GL_PATCHES, app.scene.model.face_index_count, GL_UNSIGNED_SHORT, 0, app.scene.num_points * num_views);
+        glBindVertexArray(0);
+
+        glUseProgram(0);
+        return;
+    }
+
+    // Pick the cheapest geometry shader variant for each chunk (or skip it entirely)
+    std::vector<int> chunk_variants(app.scene.chunks.size());
+    uint32_t counts[5] = {0, 0, 0, 0, 0};
+    size_t i;
+    int v;
+    for (i = 0; i < app.scene.chunks.size(); i++)
+    {
+        chunk_variants[i] = classifyPointChunk(app.scene.chunks[i], app);
+        counts[chunk_variants[i]]++;
+    }
+    memcpy(app.variant_chunk_counts, counts, sizeof(counts));
+
+    // Draw consecutive chunks of the same variant with one call
+    glBindVertexArray(app.scene.model.vertex_array);
+    glPatchParameteri(GL_PATCH_VERTICES, 3);
+    for (v = 0; v < 4; v++)
+    {
+        if (counts[v] == 0) continue;
+
+        useEquirectProgram(v, app);
+        drawPointChunkRuns(chunk_variants, v, GL_PATCHES, app);
+    }
+    resetPointAttribOffsets(app);
+    glBindVertexArray(0);
+
+    glUseProgram(0);
+}
+
+void renderCubemap(App &app)
+{
+    CubemapRenderer &cubemap = app.cubemap;
+
+    // Output target is whatever framebuffer is bound when called
+    GLint target_framebuffer;
+    GLint target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, target_viewport);
+
+    glUseProgram(cubemap.face_program.program);
+    if (cubemap.face_program.uniforms_version != app.uniforms_version)
+    {
+        setSceneUniforms(cubemap.face_program.uniforms, app);
+        cubemap.face_program.uniforms_version = app.uniforms_version;
+    }
+
+    // Cube face orientations follow the OpenGL cube map layout (+X, -X, +Y, -Y, +Z, -Z)
+    const glm::vec3 face_directions[6] = {glm::vec3(1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0),
+                                          glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, 0.0, -1.0)};
+    const glm::vec3 face_ups[6] = {glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, 1.0),
+                                   glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, -1.0, 0.0)};
+    glm::mat4 projection = glm::perspective((float)(M_PI / 2.0), 1.0f, 0.01f, 1000.0f);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, cubemap.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, cubemap.depth_renderbuffer);
+    glViewport(0, 0, cubemap.face_size, cubemap.face_size);
+    glBindVertexArray(app.scene.model.vertex_array);
+    std::vector<int> chunk_visible(app.scene.chunks.size());
+    int face, j;
+    size_t i;
+    for (face = 0; face < 6; face++)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cubemap.texture, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 view = glm::lookAt(app.scene.camera_pos, app.scene.camera_pos + face_directions[face], face_ups[face]);
+        glm::mat4 view_projection = projection * view;
+        glUniformMatrix4fv(uniformLocation(cubemap.face_program.uniforms, "view_projection"), 1, GL_FALSE, glm::value_ptr(view_projection));
+
+        // Skip chunks outside the 90 degree frustum (bounding sphere against the four side planes)
+        glm::vec3 side_axes[2] = {face_ups[face], glm::cross(face_directions[face], face_ups[face])};
+        for (i = 0; i < app.scene.chunks.size(); i++)
+        {
+            glm::vec3 center = app.scene.chunks[i].center - app.scene.camera_pos;
+            float margin = app.scene.chunks[i].radius * (float)M_SQRT2;
+            chunk_visible[i] = 1;
+            for (j = 0; j < 2; j++)
+            {
+                if (glm::dot(center, face_directions[face] - side_axes[j]) < -margin ||
+                    glm::dot(center, face_directions[face] + side_axes[j]) < -margin)
+                {
+                    chunk_visible[i] = 0;
+                }
+            }
+        }
+        drawPointChunkRuns(chunk_visible, 1, GL_TRIANGLES, app);
+    }
+    resetPointAttribOffsets(app);
+
+    // Resample cube faces to the equirectangular output
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewport(target_viewport[0], target_viewport[1], target_viewport[2], target_viewport[3]);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(cubemap.resample_program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap.texture);
+    glUniform1i(uniformLocation(cubemap.resample_program.uniforms, "cubemap"), 0);
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    glUseProgram(0);
+}
+
+void renderSlices(App &app)
+{
+    SliceRenderer &slices = app.slices;
+    int num_cells = slices.slice_count * slices.row_count;
+
+    // Output target is whatever framebuffer is bound when called
+    GLint target_framebuffer;
+    GLint target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, target_viewport);
+
+    glUseProgram(slices.draw_program.program);
+    if (slices.draw_program.uniforms_version != app.uniforms_version)
+    {
+        setSceneUniforms(slices.draw_program.uniforms, app);
+        updateSliceCameras(app);
+        slices.draw_program.uniforms_version = app.uniforms_version;
+    }
+
+    // Clears every layer of the slice atlas
+    glBindFramebuffer(GL_FRAMEBUFFER, slices.framebuffer);
+    glViewport(0, 0, slices.cell_width, slices.cell_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Submit the scene once per batch of slices, each geometry shader invocation projects into one slice
+    float slice_width = 2.0 * M_PI / slices.slice_count;
+    float max_offset = fabs(app.camera_offset);
+    std::vector<int> chunk_visible(app.scene.chunks.size());
+    int first_cell;
+    size_t i;
+    glBindVertexArray(app.scene.model.vertex_array);
+    for (first_cell = 0; first_cell < num_cells; first_cell += SLICE_BATCH)
+    {
+        int batch_cells = std::min(SLICE_BATCH, num_cells - first_cell);
+        glUniformMatrix4fv(uniformLocation(slices.draw_program.uniforms, "slice_view_projection[0]"), batch_cells, GL_FALSE,
+                           glm::value_ptr(slices.view_projections[first_cell]));
+        glUniform1i(uniformLocation(slices.draw_program.uniforms, "first_slice"), first_cell);
+        glUniform1i(uniformLocation(slices.draw_program.uniforms, "num_slices"), batch_cells);
+
+        // Skip chunks outside the longitude range of the batch (plus half a slice of filtering margin)
+        float first_longitude = (first_cell / slices.row_count) * slice_width - M_PI;
+        float last_longitude = ((first_cell + batch_cells - 1) / slices.row_count + 1) * slice_width - M_PI;
+        float center_longitude = 0.5 * (first_longitude + last_longitude);
+        float half_range = 0.5 * (last_longitude - first_longitude) + 0.5 * slice_width;
+        for (i = 0; i < app.scene.chunks.size(); i++)
+        {
+            glm::vec3 center = app.scene.chunks[i].center - app.scene.camera_pos;
+            float radius = app.scene.chunks[i].radius + max_offset;
+            float horizontal_distance = sqrt(center.x * center.x + center.z * center.z);
+            if (horizontal_distance <= radius)
+            {
+                chunk_visible[i] = 1;
+                continue;
+            }
+            float delta = -atan2(center.x, center.z) - center_longitude;
+            delta = fabs(delta - 2.0 * M_PI * floor((delta + M_PI) / (2.0 * M_PI)));
+            chunk_visible[i] = (delta <= half_range + asin(radius / horizontal_distance)) ? 1 : 0;
+        }
+        drawPointChunkRuns(chunk_visible, 1, GL_TRIANGLES, app);
+    }
+    resetPointAttribOffsets(app);
+
+    // Stitch the slices into the equirectangular output
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewport(target_viewport[0], target_viewport[1], target_viewport[2], target_viewport[3]);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(slices.resample_program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, slices.color_texture);
+    glUniform1i(uniformLocation(slices.resample_program.uniforms, "slices"), 0);
+    glUniform1i(uniformLocation(slices.resample_program.uniforms, "slice_columns"), slices.slice_count);
+    glUniform1i(uniformLocation(slices.resample_program.uniforms, "slice_rows"), slices.row_count);
+    glUniform4fv(uniformLocation(slices.resample_program.uniforms, "row_bounds[0]"), slices.row_count, glm::value_ptr(slices.row_bounds[0]));
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    glUseProgram(0);
+}
+
+void renderEqualAreaLayout(App &app)
+{
+    RenderLayout &render_layout = app.render_layout;
+
+    // Output target is whatever framebuffer is bound when called
+    GLint target_framebuffer;
+    GLint target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, target_viewport);
+
+    // Shade and tessellate in the equal-area layout
+    glBindFramebuffer(GL_FRAMEBUFFER, render_layout.framebuffer);
+    glViewport(0, 0, render_layout.width, render_layout.height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderTessellatedPoints(app);
+
+    // Resample to the equirectangular output
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewport(target_viewport[0], target_viewport[1], target_viewport[2], target_viewport[3]);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(render_layout.resample_program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, render_layout.texture);
+    glUniform1i(uniformLocation(render_layout.resample_program.uniforms, "layout_image"), 0);
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    glUseProgram(0);
+}
+
+void renderTiles(int width, int height, int tile_width, int tile_height, const char *filename, App &app)
+{
+    // Output is rendered tile by tile into a tile sized target, each tile with the sub-window of the output bounds
+    // it covers (so chunks and points outside the tile are culled), and its rows written straight to their place in the
+    // file (PPM rows have a fixed length, so memory use grows with the tile size only)
+    if (std::max(tile_width, tile_height) > maxFramebufferSize())
+    {
+        std::cerr << "Error: tile size " << tile_width << "x" << tile_height << " exceeds the maximum framebuffer size " << maxFramebufferSize() << std::endl;
+        exit(1);
+    }
+    tile_width = std::min(tile_width, width);
+    tile_height = std::min(tile_height, height);
+
+    // Tile target
+    GLuint tile_texture, tile_depth, tile_framebuffer;
+    glGenTextures(1, &tile_texture);
+    glBindTexture(GL_TEXTURE_2D, tile_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tile_width, tile_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenRenderbuffers(1, &tile_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, tile_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, tile_width, tile_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &tile_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, tile_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tile_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, tile_depth);
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "Error: cannot open " << filename << std::endl;
+        exit(1);
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", width, height);
+    size_t header_size = (size_t)ftell(fp);
+
+    // Only one tile is held in memory
+    uint8_t *tile_pixels = new uint8_t[(size_t)tile_width * tile_height * 3];
+
+    // Output state that each tile overrides (restored once all tiles are written)
+    glm::vec4 bounds = app.output_bounds;
+    bool partial_output = app.partial_output;
+    int framebuffer_width = app.framebuffer_width;
+    int framebuffer_height = app.framebuffer_height;
+    int num_tiles = ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+    double start_time = glfwGetTime();
+    int x0, y0, y;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (y0 = 0; y0 < height; y0 += tile_height)
+    {
+        int h = std::min(tile_height, height - y0);
+        for (x0 = 0; x0 < width; x0 += tile_width)
+        {
+            int w = std::min(tile_width, width - x0);
+
+            // Tile bounds in longitude / latitude (rows run from the top of the output)
+            app.output_bounds = glm::vec4(bounds.x + (bounds.y - bounds.x) * x0 / width, bounds.x + (bounds.y - bounds.x) * (x0 + w) / width,
+                                          bounds.w - (bounds.w - bounds.z) * (y0 + h) / height, bounds.w - (bounds.w - bounds.z) * y0 / height);
+            app.partial_output = true;
+            app.framebuffer_width = w;
+            app.framebuffer_height = h;
+            app.uniforms_version++;
+
+            glViewport(0, 0, w, h);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderTessellatedPoints(app);
+
+            // Flip to top-down rows and write each one at its offset in the image
+            glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, tile_pixels);
+            for (y = 0; y < h; y++)
+            {
+                size_t offset = header_size + ((size_t)(y0 + y) * width + x0) * 3;
+#ifdef _WIN32
+                _fseeki64(fp, offset, SEEK_SET);
+#else
+                fseeko(fp, offset, SEEK_SET);
+#endif
+                fwrite(tile_pixels + (size_t)(h - 1 - y) * w * 3, sizeof(uint8_t), (size_t)w * 3, fp);
+            }
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    app.output_bounds = bounds;
+    app.partial_output = partial_output;
+    app.framebuffer_width = framebuffer_width;
+    app.framebuffer_height = framebuffer_height;
+    app.uniforms_version++;
+    fclose(fp);
+    printf("Saved %dx%d image in %d tiles of %dx%d (%.3lf s)\n", width, height, num_tiles, tile_width, tile_height, glfwGetTime() - start_time);
+
+    delete[] tile_pixels;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &tile_framebuffer);
+    glDeleteRenderbuffers(1, &tile_depth);
+    glDeleteTextures(1, &tile_texture);
+}
+
+int maxFramebufferSize()
+{
+    // Largest width / height a color texture and depth renderbuffer can both have and a viewport can cover
+    GLint max_texture_size, max_renderbuffer_size, max_viewport_dims[2];
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer_size);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, max_viewport_dims);
+    return std::min(std::min(max_texture_size, max_renderbuffer_size), std::min(max_viewport_dims[0], max_viewport_dims[1]));
+}
+
+void drawPointChunkRuns(std::vector<int> &chunk_values, int value, GLenum mode, App &app)
+{
+    // Consecutive chunks with the given value are drawn with one call (base instance needs OpenGL 4.2,
+    // so the per-instance attributes are offset instead - see `resetPointAttribOffsets`), batched views
+    // draw every point once per view
+    int num_views = app.views.enabled ? app.views.count : 1;
+    size_t i = 0;
+    while (i < app.scene.chunks.size())
+    {
+        if (chunk_values[i] != value)
+        {
+            i++;
+            continue;
+        }
+        uint32_t first_point = app.scene.chunks[i].first_point;
+        uint32_t num_points = 0;
+        while (i < app.scene.chunks.size() && chunk_values[i] == value)
+        {
+            num_points += app.scene.chunks[i].num_points;
+            i++;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_center_buffer);
+        glVertexAttribPointer(app.point_center_attrib, 3, GL_FLOAT, false, 0, (void*)(3 * first_point * sizeof(GLfloat)));
+        glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_color_buffer);
+        glVertexAttribPointer(app.point_color_attrib, 3, GL_FLOAT, false, 0, (void*)(3 * first_point * sizeof(GLfloat)));
+        glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_size_buffer);
+        glVertexAttribPointer(app.point_size_attrib, 1, GL_FLOAT, false, 0, (void*)(first_point * sizeof(GLfloat)));
+        glDrawElementsInstanced(mode, app.scene.model.face_index_count, GL_UNSIGNED_SHORT, 0, num_points * num_views);
+    }
+}
+
+void resetPointAttribOffsets(App &app)
+{
+    // Restore attribute offsets for other users of the VAO
+    glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_center_buffer);
+    glVertexAttribPointer(app.point_center_attrib, 3, GL_FLOAT, false, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_color_buffer);
+    glVertexAttribPointer(app.point_color_attrib, 3, GL_FLOAT, false, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, app.scene.model.point_size_buffer);
+    glVertexAttribPointer(app.point_size_attrib, 1, GL_FLOAT, false, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void benchmarkResolutions(std::string resolutions, std::string renderers, std::string point_fractions, int num_frames, App &app)
+{
+    if (app.renderer == RENDERER_COMPUTE || app.geometry_capture.enabled || app.stereo != STEREO_NONE)
+    {
+        std::cerr << "Error: resolution benchmark requires a single eye tessellation, cubemap or slices renderer" << std::endl;
+        exit(1);
+    }
+
+    // Renderers and scene sizes to compare, e.g. "tessellation,cubemap" and "0.25,0.5,1"
+    // (`equal-area` is the tessellation renderer with the equal-area internal layout)
+    std::vector<int> renderer_list;
+    std::vector<int> layout_list;
+    std::stringstream renderer_names(renderers);
+    std::string renderer_name;
+    while (std::getline(renderer_names, renderer_name, ','))
+    {
+        layout_list.push_back(LAYOUT_EQUIRECT);
+        if (renderer_name == "tessellation")
+        {
+            renderer_list.push_back(RENDERER_TESSELLATION);
+        }
+        else if (renderer_name == "equal-area")
+        {
+            renderer_list.push_back(RENDERER_TESSELLATION);
+            layout_list.back() = LAYOUT_EQUAL_AREA;
+        }
+        else if (renderer_name == "cubemap")
+        {
+            if (app.camera_offset != 0.0f)
+            {
+                std::cerr << "Error: cubemap renderer only supports mono output (camera offset 0)" << std::endl;
+                exit(1);
+            }
+            renderer_list.push_back(RENDERER_CUBEMAP);
+        }
+        else if (renderer_name == "slices")
+        {
+            renderer_list.push_back(RENDERER_SLICES);
+        }
+        else
+        {
+            std::cerr << "Error: renderer '" << renderer_name << "' cannot be benchmarked" << std::endl;
+            exit(1);
+        }
+        if (app.partial_output && (renderer_list.back() != RENDERER_TESSELLATION || layout_list.back() != LAYOUT_EQUIRECT))
+        {
+            std::cerr << "Error: output ranges only apply to the `tessellation` benchmark renderer" << std::endl;
+            exit(1);
+        }
+    }
+    if (app.renderer != RENDERER_CUBEMAP && std::find(renderer_list.begin(), renderer_list.end(), RENDERER_CUBEMAP) != renderer_list.end())
+    {
+        initializeCubemap(app);
+    }
+    if (app.renderer != RENDERER_SLICES && std::find(renderer_list.begin(), renderer_list.end(), RENDERER_SLICES) != renderer_list.end())
+    {
+        initializeSlices(app);
+    }
+    int render_layout = app.render_layout.layout;
+    if (render_layout == LAYOUT_EQUIRECT && std::find(layout_list.begin(), layout_list.end(), LAYOUT_EQUAL_AREA) != layout_list.end())
+    {
+        initializeRenderLayout(app);
+    }
+    std::vector<float> fraction_list;
+    std::stringstream fraction_values(point_fractions);
+    std::string fraction_value;
+    while (std::getline(fraction_values, fraction_value, ','))
+    {
+        float fraction = std::stof(fraction_value);
+        if (fraction <= 0.0f || fraction > 1.0f)
+        {
+            std::cerr << "Error: point fraction must be in (0, 1], got '" << fraction_value << "'" << std::endl;
+            exit(1);
+        }
+        fraction_list.push_back(fraction);
+    }
+
+    GLint max_size;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_size);
+
+    GLuint queries[3];
+    glGenQueries(3, queries);
+    int renderer = app.renderer;
+    int framebuffer_width = app.framebuffer_width;
+    int framebuffer_height = app.framebuffer_height;
+    uint32_t num_points = app.scene.num_points;
+    std::vector<PointChunk> chunks = app.scene.chunks;
+    int i;
+    size_t j, k;
+
+    printf("Renderer benchmark (%d frames per configuration, target edge length %.2f px)\n", num_frames, app.tess_edge_pixels);
+    printf("%12s %12s %10s %14s %14s %14s %14s\n", "renderer", "resolution", "points", "triangles", "samples", "gpu ms/frame", "wall ms/frame");
+
+    // Resolutions are given as a comma separated list, e.g. "1440x720,4096x2048"
+    std::stringstream resolution_list(resolutions);
+    std::string resolution;
+    while (std::getline(resolution_list, resolution, ','))
+    {
+        int width, height;
+        if (sscanf(resolution.c_str(), "%dx%d", &width, &height) != 2)
+        {
+            std::cerr << "Error: invalid resolution '" << resolution << "'" << std::endl;
+            exit(1);
+        }
+        if (width > max_size || height > max_size)
+        {
+            printf("%12s %12s   skipped (exceeds max framebuffer size %d)\n", "", resolution.c_str(), max_size);
+            continue;
+        }
+
+        // Offscreen target at the requested resolution
+        GLuint color_texture, depth_renderbuffer, framebuffer;
+        glGenTextures(1, &color_texture);
+        glBindTexture(GL_TEXTURE_2D, color_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenRenderbuffers(1, &depth_renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glGenFramebuffers(1, &framebuffer);
+
+        // Tessellation levels and the default cube face size depend on the output size
+        app.framebuffer_width = width;
+        app.framebuffer_height = height;
+        app.uniforms_version++;
+
+        for (j = 0; j < fraction_list.size(); j++)
+        {
+            // Smaller scenes keep a prefix of the Morton ordered chunks, so they stay spatially coherent
+            uint32_t num_chunks = std::max((uint32_t)1, (uint32_t)(fraction_list[j] * chunks.size() + 0.5f));
+            app.scene.chunks.assign(chunks.begin(), chunks.begin() + std::min(num_chunks, (uint32_t)chunks.size()));
+            app.scene.num_points = app.scene.chunks.back().first_point + app.scene.chunks.back().num_points;
+
+            for (k = 0; k < renderer_list.size(); k++)
+            {
+                app.renderer = renderer_list[k];
+                app.render_layout.layout = layout_list[k];
+                app.uniforms_version++;
+                if (app.renderer == RENDERER_CUBEMAP) resizeCubemap(app);
+                if (app.renderer == RENDERER_SLICES) resizeSlices(app);
+                if (app.render_layout.layout == LAYOUT_EQUAL_AREA) resizeRenderLayout(app);
+
+                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+                glViewport(0, 0, width, height);
+
+                // Warm up, then time all frames
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderScene(app);
+                glFinish();
+
+                GLuint64 total_gpu_time = 0;
+                GLuint64 total_triangles = 0;
+                GLuint64 total_samples = 0;
+                double start_time = glfwGetTime();
+                for (i = 0; i < num_frames; i++)
+                {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+                    glBeginQuery(GL_PRIMITIVES_GENERATED, queries[1]);
+                    glBeginQuery(GL_SAMPLES_PASSED, queries[2]);
+                    renderScene(app);
+                    glEndQuery(GL_SAMPLES_PASSED);
+                    glEndQuery(GL_PRIMITIVES_GENERATED);
+                    glEndQuery(GL_TIME_ELAPSED);
+
+                    GLuint64 gpu_time, triangles, samples;
+                    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &gpu_time);
+                    glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &triangles);
+                    glGetQueryObjectui64v(queries[2], GL_QUERY_RESULT, &samples);
+                    total_gpu_time += gpu_time;
+                    total_triangles += triangles;
+                    total_samples += samples;
+                }
+                glFinish();
+                double wall_time = glfwGetTime() - start_time;
+
+                const char *renderer_names[4] = {"tessellation", "compute", "cubemap", "slices"};
+                printf("%12s %12s %10u %14llu %14llu %14.3lf %14.3lf\n",
+                       (app.render_layout.layout == LAYOUT_EQUAL_AREA) ? "equal-area" : renderer_names[app.renderer], resolution.c_str(),
+                       app.scene.num_points, (unsigned long long)(total_triangles / num_frames), (unsigned long long)(total_samples / num_frames),
+                       (double)total_gpu_time / (1.0e6 * num_frames), 1000.0 * wall_time / num_frames);
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &depth_renderbuffer);
+        glDeleteTextures(1, &color_texture);
+    }
+
+    glDeleteQueries(3, queries);
+
+    // Restore regular output
+    app.renderer = renderer;
+    app.render_layout.layout = render_layout;
+    app.scene.chunks = chunks;
+    app.scene.num_points = num_points;
+    app.framebuffer_width = framebuffer_width;
+    app.framebuffer_height = framebuffer_height;
+    app.uniforms_version++;
+    if (app.renderer == RENDERER_CUBEMAP) resizeCubemap(app);
+    if (app.renderer == RENDERER_SLICES) resizeSlices(app);
+    if (app.render_layout.layout == LAYOUT_EQUAL_AREA) resizeRenderLayout(app);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+}
+
+void renderSynthesizedStereo(App &app)
+{
+    // Render left eye with linear distance
+    glBindFramebuffer(GL_FRAMEBUFFER, app.eye_synthesis.framebuffers[0]);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderTessellatedPoints(app);
+
+    // Warp it to the right eye and output both
+    synthesizeEye(app);
+    presentSynthesizedStereo(app);
+}
+
+void synthesizeEye(App &app)
+{
+    EyeSynthesis &synthesis = app.eye_synthesis;
+
+    // Clear with alpha 0 so pixels no warped triangle covers can be told apart
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+    glBindFramebuffer(GL_FRAMEBUFFER, synthesis.framebuffers[1]);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], 0.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, synthesis.color_textures[0]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, synthesis.depth_textures[0]);
+
+    // Triangles (one strip per pair of pixel rows) first, then points
+    // (background at the far plane must pass the depth test)
+    GlslProgram *programs[2] = {&(synthesis.warp_program), &(synthesis.splat_program)};
+    int i;
+    glDepthFunc(GL_LEQUAL);
+    glBindVertexArray(app.empty_vertex_array);
+    for (i = 0; i < 2; i++)
+    {
+        std::map<std::string, GLint> &uniforms = programs[i]->uniforms;
+        glUseProgram(programs[i]->program);
+        glUniform1i(uniformLocation(uniforms, "source_color"), 0);
+        glUniform1i(uniformLocation(uniforms, "source_depth"), 1);
+        glUniform2i(uniformLocation(uniforms, "image_size"), app.framebuffer_width, app.framebuffer_height);
+        glUniform1i(uniformLocation(uniforms, "vertices_per_pixel"), (i == 0) ? 2 : 1);
+        glUniform3fv(uniformLocation(uniforms, "camera_position"), 1, glm::value_ptr(app.scene.camera_pos));
+        glUniform1f(uniformLocation(uniforms, "source_offset"), app.camera_offset);
+        glUniform1f(uniformLocation(uniforms, "target_offset"), -app.camera_offset);
+        glUniform1f(uniformLocation(uniforms, "max_depth_ratio"), synthesis.max_depth_ratio);
+        if (i == 0)
+        {
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * app.framebuffer_width, app.framebuffer_height - 1);
+        }
+        else
+        {
+            glDrawArraysInstanced(GL_POINTS, 0, app.framebuffer_width, app.framebuffer_height);
+        }
+    }
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+void presentSynthesizedStereo(App &app)
+{
+    EyeSynthesis &synthesis = app.eye_synthesis;
+
+    // Left eye (rendered) in the top half, right eye (warped, holes filled) in the bottom half
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(synthesis.fill_program.program);
+    glUniform1i(uniformLocation(synthesis.fill_program.uniforms, "image"), 0);
+    glUniform1i(uniformLocation(synthesis.fill_program.uniforms, "image_depth"), 1);
+    glUniform1i(uniformLocation(synthesis.fill_program.uniforms, "max_fill_distance"), synthesis.max_fill_distance);
+    glBindVertexArray(app.empty_vertex_array);
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        glViewport(0, (i == 0) ? app.framebuffer_height : 0, app.framebuffer_width, app.framebuffer_height);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, synthesis.color_textures[i]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, synthesis.depth_textures[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+}
+
+void benchmarkEyeSynthesis(int num_frames, App &app)
+{
+    if (app.stereo != STEREO_SYNTHESIZED)
+    {
+        std::cerr << "Error: synthesis benchmark requires `--stereo synthesized`" << std::endl;
+        exit(1);
+    }
+
+    EyeSynthesis &synthesis = app.eye_synthesis;
+    int num_pixels = app.framebuffer_width * app.framebuffer_height;
+    GLuint query;
+    glGenQueries(1, &query);
+    GLuint64 gpu_time;
+    GLuint64 render_time = 0;
+    GLuint64 synthesis_time = 0;
+    int i;
+
+    printf("Eye synthesis benchmark (%d frames, %dx%d per eye, camera offset %.4f)\n", num_frames, app.framebuffer_width,
+           app.framebuffer_height, fabs(app.camera_offset));
+
+    // Time warp + hole fill of the left eye
+    glBindFramebuffer(GL_FRAMEBUFFER, synthesis.framebuffers[0]);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderTessellatedPoints(app);
+    for (i = 0; i < num_frames; i++)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        synthesizeEye(app);
+        presentSynthesizedStereo(app);
+        glEndQuery(GL_TIME_ELAPSED);
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+        synthesis_time += gpu_time;
+    }
+
+    // Coverage of the warp and the final synthesized eye
+    uint8_t *warped = new uint8_t[num_pixels * 4];
+    uint8_t *synthesized = new uint8_t[num_pixels * 4];
+    uint8_t *reference = new uint8_t[num_pixels * 4];
+    glBindTexture(GL_TEXTURE_2D, synthesis.color_textures[1]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, warped);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glReadPixels(0, 0, app.framebuffer_width, app.framebuffer_height, GL_RGBA, GL_UNSIGNED_BYTE, synthesized);
+
+    // Time a full render of the right eye for reference
+    app.camera_offset = -app.camera_offset;
+    app.uniforms_version++;
+    glBindFramebuffer(GL_FRAMEBUFFER, synthesis.framebuffers[0]);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+    for (i = 0; i < num_frames; i++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        renderTessellatedPoints(app);
+        glEndQuery(GL_TIME_ELAPSED);
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+        render_time += gpu_time;
+    }
+    glBindTexture(GL_TEXTURE_2D, synthesis.color_textures[0]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, reference);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    app.camera_offset = -app.camera_offset;
+    app.uniforms_version++;
+
+    // Image error of the synthesized eye against the full render
+    int holes = 0;
+    int differing = 0;
+    double total_error = 0.0;
+    for (i = 0; i < num_pixels; i++)
+    {
+        if (warped[4 * i + 3] == 0) holes++;
+        int error = std::max(abs(synthesized[4 * i] - reference[4 * i]), std::max(abs(synthesized[4 * i + 1] - reference[4 * i + 1]),
+                             abs(synthesized[4 * i + 2] - reference[4 * i + 2])));
+        total_error += (abs(synthesized[4 * i] - reference[4 * i]) + abs(synthesized[4 * i + 1] - reference[4 * i + 1]) +
+                        abs(synthesized[4 * i + 2] - reference[4 * i + 2])) / 3.0;
+        if (error > 8) differing++;
+    }
+    delete[] warped;
+    delete[] synthesized;
+    delete[] reference;
+    glDeleteQueries(1, &query);
+
+    printf("%24s %10.3lf ms\n", "full eye render:", (double)render_time / (1.0e6 * num_frames));
+    printf("%24s %10.3lf ms (%.1lf%% of full render)\n", "synthesized eye:", (double)synthesis_time / (1.0e6 * num_frames),
+           100.0 * (double)synthesis_time / (double)render_time);
+    printf("%24s %10.3lf %%\n", "disoccluded (filled):", 100.0 * holes / num_pixels);
+    printf("%24s %10.3lf\n", "mean abs error:", total_error / num_pixels);
+    printf("%24s %10.3lf %%\n", "pixels off by > 8:", 100.0 * differing / num_pixels);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+}
+
+void benchmarkSlices(std::string slice_counts, int num_frames, App &app)
+{
+    if (app.renderer != RENDERER_SLICES)
+    {
+        std::cerr << "Error: slice benchmark requires `--renderer slices`" << std::endl;
+        exit(1);
+    }
+
+    int num_pixels = app.framebuffer_width * app.framebuffer_height;
+    int slice_count = app.slices.slice_count;
+    GLuint query;
+    glGenQueries(1, &query);
+    GLuint64 gpu_time;
+    int i, j;
+
+    printf("Slice benchmark (%d frames, %dx%d, %d rows, camera offset %.4f)\n", num_frames, app.framebuffer_width,
+           app.framebuffer_height, app.slices.row_count, app.camera_offset);
+    printf("%14s %8s %12s %14s %16s %16s\n", "renderer", "slices", "submissions", "gpu ms/frame", "mean abs error", "pixels off > 8");
+
+    // Reference: per-vertex projection of the tessellation renderer
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glViewport(0, 0, app.framebuffer_width, app.framebuffer_height);
+    GLuint64 render_time = 0;
+    for (i = 0; i < num_frames; i++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        renderTessellatedPoints(app);
+        glEndQuery(GL_TIME_ELAPSED);
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+        render_time += gpu_time;
+    }
+    uint8_t *reference = new uint8_t[num_pixels * 4];
+    uint8_t *sliced = new uint8_t[num_pixels * 4];
+    glReadPixels(0, 0, app.framebuffer_width, app.framebuffer_height, GL_RGBA, GL_UNSIGNED_BYTE, reference);
+    printf("%14s %8s %12d %14.3lf %16s %16s\n", "tessellation", "-", 1, (double)render_time / (1.0e6 * num_frames), "-", "-");
+
+    // Slice counts are given as a comma separated list, e.g. "16,32,64,128"
+    std::stringstream count_list(slice_counts);
+    std::string count;
+    while (std::getline(count_list, count, ','))
+    {
+        app.slices.slice_count = std::stoi(count);
+        if (app.slices.slice_count < 4)
+        {
+            std::cerr << "Error: slice renderer needs at least 4 slices, got '" << count << "'" << std::endl;
+            exit(1);
+        }
+        resizeSlices(app);
+
+        GLuint64 slice_time = 0;
+        for (i = 0; i < num_frames; i++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            renderSlices(app);
+            glEndQuery(GL_TIME_ELAPSED);
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+            slice_time += gpu_time;
+        }
+        glReadPixels(0, 0, app.framebuffer_width, app.framebuffer_height, GL_RGBA, GL_UNSIGNED_BYTE, sliced);
+
+        // Image error against the per-vertex projection
+        int differing = 0;
+        double total_error = 0.0;
+        for (j = 0; j < num_pixels; j++)
+        {
+            int error = std::max(abs(sliced[4 * j] - reference[4 * j]), std::max(abs(sliced[4 * j + 1] - reference[4 * j + 1]),
+                                 abs(sliced[4 * j + 2] - reference[4 * j + 2])));
+            total_error += (abs(sliced[4 * j] - reference[4 * j]) + abs(sliced[4 * j + 1] - reference[4 * j + 1]) +
+                            abs(sliced[4 * j + 2] - reference[4 * j + 2])) / 3.0;
+            if (error > 8) differing++;
+        }
+
+        int num_cells = app.slices.slice_count * app.slices.row_count;
+        printf("%14s %8d %12d %14.3lf %16.3lf %15.3lf%%\n", "slices", app.slices.slice_count, (num_cells + SLICE_BATCH - 1) / SLICE_BATCH,
+               (double)slice_time / (1.0e6 * num_frames), total_error / num_pixels, 100.0 * differing / num_pixels);
+    }
+    delete[] reference;
+    delete[] sliced;
+    glDeleteQueries(1, &query);
+
+    // Restore requested slice count
+    app.slices.slice_count = slice_count;
+    resizeSlices(app);
+}
+
+void renderPointSplat(App &app)
+{
+    // Point data is read directly from the instanced vertex buffers
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, app.scene.model.point_center_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, app.scene.model.point_color_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, app.scene.model.point_size_buffer);
+    glBindImageTexture(0, app.splat_depth_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    glBindImageTexture(1, app.splat_color_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+
+    // One invocation per point - spread work groups over 2D grid since each dimension is limited to 65535
+    uint32_t num_groups = (app.scene.num_points + 255) / 256;
+    uint32_t groups_x = std::min(num_groups, (uint32_t)65535);
+    uint32_t groups_y = (num_groups + groups_x - 1) / groups_x;
+
+    glUseProgram(app.splat_program.program);
+
+    // pass 0: nearest distance per pixel
+    glUniform1i(uniformLocation(app.splat_program.uniforms, "splat_pass"), 0);
+    glDispatchCompute(groups_x, groups_y, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // pass 1: color of point whose distance matches the nearest one
+    glUniform1i(uniformLocation(app.splat_program.uniforms, "splat_pass"), 1);
+    glDispatchCompute(groups_x, groups_y, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // Copy splats to framebuffer (also resets distance image for next frame)
+    glUseProgram(app.resolve_program.program);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    glUseProgram(0);
+}
+
+void renderCapturedGeometry(App &app)
+{
+    GeometryCapture &capture = app.geometry_capture;
+
+    // Projected geometry only depends on camera and point data (lighting is applied when replaying)
+    if (!capture.valid || capture.camera_position != app.scene.camera_pos || capture.camera_offset != app.camera_offset ||
+        capture.scene_version != app.scene.version)
+    {
+        captureGeometry(app);
+        return;
+    }
+
+    glUseProgram(capture.replay_program.program);
+    glBindVertexArray(capture.vertex_array);
+    glDrawTransformFeedback(GL_TRIANGLES, capture.feedback);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void captureGeometry(App &app)
+{
+    GeometryCapture &capture = app.geometry_capture;
+
+    // Render normally while recording all triangles emitted by the geometry shader. If the feedback buffer overflowed,
+    // it is grown and the capture repeated once - the same draw emits the same triangles, so the second one fits
+    GLuint num_primitives = 0;
+    int attempt;
+    for (attempt = 0; attempt < 2; attempt++)
+    {
+        if (attempt > 0)
+        {
+            if (num_primitives > MAX_CAPTURED_TRIANGLES)
+            {
+                std::cerr << "Error: geometry capture needs " << num_primitives << " triangles, more than the limit of "
+                          << MAX_CAPTURED_TRIANGLES << std::endl;
+                exit(1);
+            }
+            capture.capacity = std::min(num_primitives + num_primitives / 4, (GLuint)MAX_CAPTURED_TRIANGLES);
+            glBindBuffer(GL_ARRAY_BUFFER, capture.buffer);
+            glBufferData(GL_ARRAY_BUFFER, 3 * (GLsizeiptr)capture.capacity * 18 * sizeof(GLfloat), NULL, GL_STATIC_COPY);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        glUseProgram(app.program);
+        glBindVertexArray(app.scene.model.vertex_array);
+        glPatchParameteri(GL_PATCH_VERTICES, 3);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, capture.feedback);
+        glBeginQuery(GL_PRIMITIVES_GENERATED, capture.primitives_query);
+        glBeginTransformFeedback(GL_TRIANGLES);
+        glDrawElementsInstanced(GL_PATCHES, app.scene.model.face_index_count, GL_UNSIGNED_SHORT, 0, app.scene.num_points);
+        glEndTransformFeedback();
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+
+        glGetQueryObjectuiv(capture.primitives_query, GL_QUERY_RESULT, &num_primitives);
+        if (num_primitives <= capture.capacity)
+        {
+            break;
+        }
+    }
+    if (num_primitives > capture.capacity)
+    {
+        std::cerr << "Error: geometry capture overflowed its feedback buffer of " << capture.capacity << " triangles" << std::endl;
+        exit(1);
+    }
+
+    capture.valid = true;
+    capture.num_triangles = num_primitives;
+    capture.camera_position = app.scene.camera_pos;
+    capture.camera_offset = app.camera_offset;
+    capture.scene_version = app.scene.version;
+}
+
+void onKeyboard(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    App *app_ptr = (App*)glfwGetWindowUserPointer(window);
+
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+    {
+        saveImage("output/equirect.ppm", *app_ptr);
+    }
+}
+
+void saveImage(const char *filename, App &app)
+{
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    uint8_t *pixels = new uint8_t[image_width * layer_height * num_layers * 3];
+    readFramePixels(pixels, false, false, false, false, false, app);
+    writeImage(filename, pixels, image_width, layer_height, num_layers, false, false);
+    delete[] pixels;
+}
+
+void readFramePixels(void *pixels, bool bgra, bool converted, bool depth, bool pyramid, bool delta, App &app)
+{
+    // Copy the saved image into client memory, or into the bound pixel pack buffer (`pixels` is then an offset)
+    // (BGRA is the native layout of most drivers, RGB needs byte packing since rows are not 4-byte aligned in general)
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    GLenum format = bgra ? GL_BGRA : GL_RGB;
+    glPixelStorei(GL_PACK_ALIGNMENT, bgra ? 4 : 1);
+    if (converted)
+    {
+        // delivery layout from the conversion pass (I420 planes are one byte per texel)
+        FrameConversion &conversion = app.conversion;
+        convertFrame(app);
+        if (conversion.yuv)
+        {
+            format = GL_RED;
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, conversion.framebuffer);
+        glReadPixels(0, 0, conversion.width, conversion.target_height, format, GL_UNSIGNED_BYTE, pixels);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, app.framebuffer);
+    }
+    else
+    {
+#ifdef OFFSCREEN
+        GLenum target = (num_layers > 1) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        glBindTexture(target, app.framebuffer_texture);
+        glGetTexImage(target, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(target, 0);
+#else
+        glReadPixels(0, 0, image_width, layer_height, format, GL_UNSIGNED_BYTE, pixels);
+#endif
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    size_t color_size = (size_t)image_width * layer_height * num_layers * (bgra ? 4 : 3);
+#ifdef OFFSCREEN
+    if (depth)
+    {
+        // distance target behind the color, rows bottom-up per layer like the rendered image
+        GLenum target = (num_layers > 1) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        glBindTexture(target, app.distance_texture);
+        glGetTexImage(target, 0, GL_RED, GL_FLOAT, (uint8_t*)pixels + color_size);
+        glBindTexture(target, 0);
+    }
+#endif
+    if (pyramid)
+    {
+        // filtered levels behind the color and distances, smallest last, rows bottom-up
+        OutputPyramid &output_pyramid = app.pyramid;
+        buildOutputPyramid(app);
+        size_t offset = color_size + (depth ? (size_t)image_width * layer_height * num_layers * sizeof(float) : 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, bgra ? 4 : 1);
+        size_t i;
+        for (i = 0; i < output_pyramid.levels.size(); i++)
+        {
+            int level = output_pyramid.levels[i];
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, output_pyramid.framebuffers[level]);
+            glReadPixels(0, 0, output_pyramid.widths[level], output_pyramid.heights[level], bgra ? GL_BGRA : GL_RGB, GL_UNSIGNED_BYTE,
+                         (uint8_t*)pixels + offset);
+            offset += (size_t)output_pyramid.widths[level] * output_pyramid.heights[level] * (bgra ? 4 : 3);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, app.framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+    if (delta)
+    {
+        // changed tile flags behind the color, one byte per tile from the top-left
+        TileDelta &tile_delta = app.delta;
+        detectChangedTiles(app);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, tile_delta.flag_framebuffer);
+        glReadPixels(0, 0, tile_delta.tiles_x, tile_delta.tiles_y, GL_RED, GL_UNSIGNED_BYTE, (uint8_t*)pixels + color_size);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, app.framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+}
+
+void getSavedImageSize(App &app, int &image_width, int &layer_height, int &num_layers)
+{
+    // Stereo pairs are saved over-under (left eye on top), view atlases as they are, layered targets are stacked layer by layer
+    bool layered = app.stereo == STEREO_LAYERED || (app.views.enabled && app.views.layered);
+    bool over_under = app.stereo == STEREO_OVER_UNDER || app.stereo == STEREO_SYNTHESIZED;
+    bool atlas = app.views.enabled && !app.views.layered;
+    num_layers = (app.stereo == STEREO_LAYERED) ? 2 : (layered ? app.views.count : 1);
+    image_width = atlas ? app.views.columns * app.framebuffer_width : app.framebuffer_width;
+    layer_height = over_under ? 2 * app.framebuffer_height : (atlas ? app.views.rows * app.framebuffer_height : app.framebuffer_height);
+}
+
+size_t readbackFrameSize(App &app)
+{
+    // Bytes of one read back frame
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    size_t num_pixels = (size_t)image_width * layer_height * num_layers;
+    if (app.conversion.enabled && app.conversion.yuv)
+    {
+        return num_pixels * 3 / 2;
+    }
+    return (num_pixels + outputPyramidPixels(app)) * (app.readback.bgra ? 4 : 3) + (app.writer.depth ? num_pixels * sizeof(float) : 0) +
+           (app.delta.enabled ? (size_t)app.delta.tiles_x * app.delta.tiles_y : 0);
+}
+
+void initializeFrameConversion(App &app)
+{
+    FrameConversion &conversion = app.conversion;
+    int num_layers;
+    getSavedImageSize(app, conversion.width, conversion.layer_height, num_layers);
+    conversion.layered = num_layers > 1;
+    conversion.height = conversion.layer_height * num_layers;
+    conversion.target_height = conversion.yuv ? conversion.height * 3 / 2 : conversion.height;
+
+    std::vector<std::string> convert_filenames;
+    convert_filenames.push_back("resrc/shaders/cube_resample.vert");
+    convert_filenames.push_back("resrc/shaders/frame_convert.frag");
+    std::vector<std::string> defines;
+    if (conversion.layered)
+    {
+        defines.push_back("LAYERED");
+    }
+    if (conversion.yuv)
+    {
+        defines.push_back("YUV420");
+    }
+    loadProgramFiles(convert_filenames, conversion.program, app, defines);
+
+    // Conversion target (a single channel for I420 planes)
+    glGenTextures(1, &(conversion.texture));
+    glBindTexture(GL_TEXTURE_2D, conversion.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, conversion.yuv ? GL_R8 : GL_RGBA8, conversion.width, conversion.target_height, 0,
+                 conversion.yuv ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &(conversion.framebuffer));
+    glBindFramebuffer(GL_FRAMEBUFFER, conversion.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, conversion.texture, 0);
+
+#ifdef OFFSCREEN
+    conversion.source_texture = app.framebuffer_texture;
+    conversion.source_framebuffer = app.framebuffer;
+#else
+    // The window's back buffer cannot be sampled, it is copied (and resolved) into a texture first
+    glGenTextures(1, &(conversion.source_texture));
+    glBindTexture(GL_TEXTURE_2D, conversion.source_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, conversion.width, conversion.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &(conversion.source_framebuffer));
+    glBindFramebuffer(GL_FRAMEBUFFER, conversion.source_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, conversion.source_texture, 0);
+#endif
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+}
+
+void convertFrame(App &app)
+{
+    // Fullscreen pass from the saved image into the conversion target, so readback moves only the delivered bytes
+    FrameConversion &conversion = app.conversion;
+    GLint target_framebuffer;
+    GLfloat target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetFloati_v(GL_VIEWPORT, 0, target_viewport);
+
+#ifndef OFFSCREEN
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, conversion.source_framebuffer);
+    glBlitFramebuffer(0, 0, conversion.width, conversion.height, 0, 0, conversion.width, conversion.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+#endif
+
+    // only viewport 0 is changed, the stereo and view atlas viewports are kept
+    GLenum source_target = conversion.layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    glBindFramebuffer(GL_FRAMEBUFFER, conversion.framebuffer);
+    glViewportIndexedf(0, 0.0f, 0.0f, conversion.width, conversion.target_height);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(conversion.program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(source_target, conversion.source_texture);
+    glUniform1i(uniformLocation(conversion.program.uniforms, "image"), 0);
+    glUniform1i(uniformLocation(conversion.program.uniforms, "image_width"), conversion.width);
+    glUniform1i(uniformLocation(conversion.program.uniforms, "image_height"), conversion.height);
+    glUniform1i(uniformLocation(conversion.program.uniforms, "layer_height"), conversion.layer_height);
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(source_target, 0);
+    glEnable(GL_DEPTH_TEST);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewportIndexedfv(0, target_viewport);
+}
+
+int pyramidLevelSize(int size, int level)
+{
+    return std::max(size >> level, 1);
+}
+
+size_t outputPyramidPixels(App &app)
+{
+    // Pixels of all requested levels together
+    size_t num_pixels = 0;
+    size_t i;
+    for (i = 0; i < app.pyramid.levels.size(); i++)
+    {
+        num_pixels += (size_t)pyramidLevelSize(app.framebuffer_width, app.pyramid.levels[i]) *
+                      pyramidLevelSize(app.framebuffer_height, app.pyramid.levels[i]);
+    }
+    return num_pixels;
+}
+
+void initializeOutputPyramid(App &app)
+{
+    OutputPyramid &pyramid = app.pyramid;
+    std::vector<std::string> pyramid_filenames;
+    pyramid_filenames.push_back("resrc/shaders/cube_resample.vert");
+    pyramid_filenames.push_back("resrc/shaders/pyramid_downsample.frag");
+    loadProgramFiles(pyramid_filenames, pyramid.program, app, std::vector<std::string>());
+
+    // One target per level down to the last requested one, each level is filtered from the one above
+    int num_levels = pyramid.levels.back() + 1;
+    pyramid.widths.resize(num_levels);
+    pyramid.heights.resize(num_levels);
+    pyramid.textures.resize(num_levels);
+    pyramid.framebuffers.resize(num_levels);
+    int level;
+    for (level = 0; level < num_levels; level++)
+    {
+        pyramid.widths[level] = pyramidLevelSize(app.framebuffer_width, level);
+        pyramid.heights[level] = pyramidLevelSize(app.framebuffer_height, level);
+#ifdef OFFSCREEN
+        if (level == 0)
+        {
+            pyramid.textures[0] = app.framebuffer_texture;
+            pyramid.framebuffers[0] = app.framebuffer;
+            continue;
+        }
+#endif
+        // (level 0 of windowed builds receives a resolved copy of the back buffer)
+        glGenTextures(1, &(pyramid.textures[level]));
+        glBindTexture(GL_TEXTURE_2D, pyramid.textures[level]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pyramid.widths[level], pyramid.heights[level], 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &(pyramid.framebuffers[level]));
+        glBindFramebuffer(GL_FRAMEBUFFER, pyramid.framebuffers[level]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid.textures[level], 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+}
+
+void buildOutputPyramid(App &app)
+{
+    // Halve the rendered image level by level with a fullscreen pass each (filtering wraps around the longitude seam)
+    OutputPyramid &pyramid = app.pyramid;
+    GLint target_framebuffer;
+    GLfloat target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetFloati_v(GL_VIEWPORT, 0, target_viewport);
+
+#ifndef OFFSCREEN
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pyramid.framebuffers[0]);
+    glBlitFramebuffer(0, 0, pyramid.widths[0], pyramid.heights[0], 0, 0, pyramid.widths[0], pyramid.heights[0], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+#endif
+
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(pyramid.program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(uniformLocation(pyramid.program.uniforms, "source"), 0);
+    glBindVertexArray(app.empty_vertex_array);
+    size_t level;
+    for (level = 1; level < pyramid.textures.size(); level++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, pyramid.framebuffers[level]);
+        glViewportIndexedf(0, 0.0f, 0.0f, pyramid.widths[level], pyramid.heights[level]);
+        glBindTexture(GL_TEXTURE_2D, pyramid.textures[level - 1]);
+        glUniform2i(uniformLocation(pyramid.program.uniforms, "source_size"), pyramid.widths[level - 1], pyramid.heights[level - 1]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewportIndexedfv(0, target_viewport);
+}
+
+void initializeTileDelta(App &app)
+{
+    TileDelta &delta = app.delta;
+    int num_layers;
+    getSavedImageSize(app, delta.width, delta.height, num_layers);
+    delta.tiles_x = (delta.width + delta.tile_size - 1) / delta.tile_size;
+    delta.tiles_y = (delta.height + delta.tile_size - 1) / delta.tile_size;
+    delta.reference_valid = false;
+    delta.current = 0;
+
+    std::vector<std::string> delta_filenames;
+    delta_filenames.push_back("resrc/shaders/cube_resample.vert");
+    delta_filenames.push_back("resrc/shaders/tile_delta.frag");
+    loadProgramFiles(delta_filenames, delta.program, app, std::vector<std::string>());
+
+    // Two copies of the saved frame (the current one is compared against the other, then they swap roles)
+    glGenTextures(2, delta.textures);
+    glGenFramebuffers(2, delta.framebuffers);
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, delta.textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, delta.width, delta.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindFramebuffer(GL_FRAMEBUFFER, delta.framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, delta.textures[i], 0);
+    }
+
+    // One texel per tile
+    glGenTextures(1, &(delta.flag_texture));
+    glBindTexture(GL_TEXTURE_2D, delta.flag_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, delta.tiles_x, delta.tiles_y, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &(delta.flag_framebuffer));
+    glBindFramebuffer(GL_FRAMEBUFFER, delta.flag_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, delta.flag_texture, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+}
+
+void detectChangedTiles(App &app)
+{
+    // Copy the saved image (resolving the window's back buffer), then flag every tile that differs from the previous copy
+    TileDelta &delta = app.delta;
+    GLint target_framebuffer;
+    GLfloat target_viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+    glGetFloati_v(GL_VIEWPORT, 0, target_viewport);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, app.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, delta.framebuffers[delta.current]);
+    glBlitFramebuffer(0, 0, delta.width, delta.height, 0, 0, delta.width, delta.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, delta.flag_framebuffer);
+    glViewportIndexedf(0, 0.0f, 0.0f, delta.tiles_x, delta.tiles_y);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(delta.program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, delta.textures[delta.current]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, delta.textures[1 - delta.current]);
+    glUniform1i(uniformLocation(delta.program.uniforms, "image"), 0);
+    glUniform1i(uniformLocation(delta.program.uniforms, "reference"), 1);
+    glUniform1i(uniformLocation(delta.program.uniforms, "tile_size"), delta.tile_size);
+    glUniform1i(uniformLocation(delta.program.uniforms, "reference_valid"), delta.reference_valid ? 1 : 0);
+    glBindVertexArray(app.empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+    glViewportIndexedfv(0, target_viewport);
+    delta.reference_valid = true;
+    delta.current = 1 - delta.current;
+}
+
+void initializeFrameReadback(App &app)
+{
+    // Ring of pixel pack buffers, each big enough for one saved frame
+    FrameReadback &readback = app.readback;
+    getSavedImageSize(app, readback.image_width, readback.layer_height, readback.num_layers);
+    GLsizeiptr size = (GLsizeiptr)readbackFrameSize(app);
+    readback.buffers.resize(readback.ring_size);
+    readback.fences.assign(readback.ring_size, (GLsync)0);
+    readback.filenames.assign(readback.ring_size, "");
+    glGenBuffers(readback.ring_size, readback.buffers.data());
+    int i;
+    for (i = 0; i < readback.ring_size; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.next = 0;
+    readback.num_frames = 0;
+    readback.wait_time = 0.0;
+}
+
+void queueFrameReadback(const char *filename, App &app)
+{
+    // Start copying the frame into the next buffer of the ring without waiting for it, the frame that
+    // used this buffer `ring_size` frames ago is written out first (most likely finished by now)
+    FrameReadback &readback = app.readback;
+    int slot = readback.next;
+    if (readback.fences[slot] != 0)
+    {
+        completeFrameReadback(slot, app);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffers[slot]);
+    readFramePixels((void*)0, readback.bgra, app.conversion.enabled, app.writer.depth, !app.pyramid.levels.empty(), app.delta.enabled, app);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.filenames[slot] = filename;
+    readback.next = (slot + 1) % readback.ring_size;
+}
+
+void completeFrameReadback(int slot, App &app)
+{
+    // Wait for the copy (flushing so the fence is guaranteed to signal), then hand the mapped pixels to the writer
+    FrameReadback &readback = app.readback;
+    double start_time = glfwGetTime();
+    GLenum wait_result = GL_TIMEOUT_EXPIRED;
+    while (wait_result == GL_TIMEOUT_EXPIRED)
+    {
+        wait_result = glClientWaitSync(readback.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    if (wait_result == GL_WAIT_FAILED)
+    {
+        std::cerr << "Error: waiting for the readback of " << readback.filenames[slot] << " failed" << std::endl;
+        exit(1);
+    }
+    glDeleteSync(readback.fences[slot]);
+    readback.fences[slot] = 0;
+
+    GLsizeiptr size = (GLsizeiptr)readbackFrameSize(app);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffers[slot]);
+    uint8_t *pixels = (uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    readback.wait_time += glfwGetTime() - start_time;
+    if (pixels != NULL)
+    {
+        uint8_t *frame_pixels = acquireFrameBuffer(app);
+        if (frame_pixels != NULL)
+        {
+            memcpy(frame_pixels, pixels, size);
+            submitFrameWrite(readback.filenames[slot].c_str(), frame_pixels, readback.bgra, app);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        std::cerr << "Error: cannot map readback buffer for " << readback.filenames[slot] << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.num_frames++;
+}
+
+void finishFrameReadback(App &app)
+{
+    // Write the frames still in flight, oldest first
+    FrameReadback &readback = app.readback;
+    int i;
+    for (i = 0; i < readback.ring_size; i++)
+    {
+        int slot = (readback.next + i) % readback.ring_size;
+        if (readback.fences[slot] != 0)
+        {
+            completeFrameReadback(slot, app);
+        }
+    }
+    if (readback.num_frames > 0)
+    {
+        printf("Read back %u frames through %d buffers (%.3lf ms avg wait for the GPU copy)\n", readback.num_frames, readback.ring_size,
+               1000.0 * readback.wait_time / readback.num_frames);
+    }
+}
+
+void initializeSharedFrameRing(App &app)
+{
+    // Create the ring (replacing a stale one of the same name) and describe the frames, readers wait for the magic
+    SharedFrameRing &ring = app.frame_ring;
+#ifndef _WIN32
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    uint64_t frame_size = readbackFrameSize(app);
+    uint64_t slot_size = (FRAME_RING_SLOT_HEADER_SIZE + frame_size + 4095) & ~(uint64_t)4095;
+    ring.size = frameRingSize(ring.num_slots, slot_size);
+    shm_unlink(ring.name.c_str());
+    int fd = shm_open(ring.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, ring.size) != 0)
+    {
+        std::cerr << "Error: cannot create shared memory " << ring.name << " of " << ring.size << " bytes" << std::endl;
+        exit(1);
+    }
+    void *memory = mmap(NULL, ring.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "Error: cannot map shared memory " << ring.name << std::endl;
+        exit(1);
+    }
+    ring.memory = (uint8_t*)memory;
+    ring.header = (FrameRingHeader*)memory;
+    ring.header->version = FRAME_RING_VERSION;
+    ring.header->num_slots = ring.num_slots;
+    ring.header->pixel_format = app.readback.bgra ? FRAME_RING_FORMAT_BGRA : FRAME_RING_FORMAT_RGB;
+    ring.header->width = image_width;
+    ring.header->layer_height = layer_height;
+    ring.header->num_layers = num_layers;
+    ring.header->top_down = app.conversion.enabled ? 1 : 0;
+    ring.header->eye = ring.eye;
+    ring.header->checksums = ring.checksums ? 1 : 0;
+    ring.header->frame_size = frame_size;
+    ring.header->slot_size = slot_size;
+    ring.header->latest.store(0);
+    ring.header->finished.store(0);
+    ring.header->magic.store(FRAME_RING_MAGIC, std::memory_order_release);
+    ring.sequence = 0;
+    printf("Publishing %dx%d frames to shared memory %s (%d slots, %.1lf MB)\n", image_width, layer_height * num_layers, ring.name.c_str(),
+           ring.num_slots, ring.size / 1.0e6);
+#endif
+}
+
+uint8_t* beginSharedFrame(App &app)
+{
+    // Claim the slot of the next frame, marking it as being written
+    SharedFrameRing &ring = app.frame_ring;
+    ring.sequence++;
+    FrameRingSlot *slot = frameRingSlot(ring.memory, ring.sequence);
+    slot->sequence.store(2 * ring.sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return frameRingPixels(slot);
+}
+
+void publishSharedFrame(uint64_t timestamp_ns, App &app)
+{
+    // Complete the claimed slot (the pixels are final once readback returns) and announce it
+    SharedFrameRing &ring = app.frame_ring;
+    FrameRingSlot *slot = frameRingSlot(ring.memory, ring.sequence);
+    slot->timestamp_ns = timestamp_ns;
+    slot->checksum = ring.checksums ? adler32(adler32(0L, Z_NULL, 0), frameRingPixels(slot), ring.header->frame_size) : 0;
+    slot->eye = ring.eye;
+    slot->sequence.store(2 * ring.sequence, std::memory_order_release);
+    ring.header->latest.store(ring.sequence, std::memory_order_release);
+}
+
+void finishSharedFrameRing(App &app)
+{
+    // Readers keep their mapping, new ones can no longer attach
+    SharedFrameRing &ring = app.frame_ring;
+#ifndef _WIN32
+    ring.header->finished.store(1, std::memory_order_release);
+    printf("Published %llu frames to shared memory %s\n", (unsigned long long)ring.sequence, ring.name.c_str());
+    munmap(ring.memory, ring.size);
+    shm_unlink(ring.name.c_str());
+#endif
+}
+
+uint64_t monotonicNanoseconds()
+{
+    // Clock shared with other processes, for frame latency
+#ifndef _WIN32
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+#else
+    return (uint64_t)(glfwGetTime() * 1.0e9);
+#endif
+}
+
+void initializePreviewServer(App &app)
+{
+    PreviewServer &preview = app.preview;
+#ifndef _WIN32
+    // Preview target at the requested width (first layer of layered images), and a buffer for its readback
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    preview.width = std::min(preview.width, image_width);
+    preview.height = std::max(1, (int)((double)preview.width * layer_height / image_width + 0.5));
+    glGenTextures(1, &(preview.texture));
+    glBindTexture(GL_TEXTURE_2D, preview.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, preview.width, preview.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &(preview.framebuffer));
+    glBindFramebuffer(GL_FRAMEBUFFER, preview.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, preview.texture, 0);
+#ifndef OFFSCREEN
+    // The window's back buffer may be multisampled, which cannot be resolved and scaled in one blit
+    glGenTextures(1, &(preview.resolve_texture));
+    glBindTexture(GL_TEXTURE_2D, preview.resolve_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image_width, layer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &(preview.resolve_framebuffer));
+    glBindFramebuffer(GL_FRAMEBUFFER, preview.resolve_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, preview.resolve_texture, 0);
+#endif
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    glGenBuffers(1, &(preview.buffer));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, preview.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)preview.width * preview.height * 3, NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    preview.fence = 0;
+    preview.last_request = -preview.interval;
+
+    // Listen on localhost only
+    preview.listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(preview.listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(preview.port);
+    if (preview.listen_socket < 0 || bind(preview.listen_socket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(preview.listen_socket, 4) != 0)
+    {
+        std::cerr << "Error: cannot listen on 127.0.0.1:" << preview.port << std::endl;
+        exit(1);
+    }
+    preview.num_clients.store(0);
+    preview.stopping.store(false);
+    preview.frame_ready = false;
+    preview.num_sent = 0;
+    preview.thread = std::thread(runPreviewServer, &preview);
+    printf("Preview stream at http://127.0.0.1:%d/ (%dx%d, up to %.1lf fps)\n", preview.port, preview.width, preview.height, 1.0 / preview.interval);
+#endif
+}
+
+void updatePreview(App &app)
+{
+    // Called once per frame on the render thread, never waits for the GPU: a finished readback is handed to the
+    // server thread, and a new one is started only while clients are connected and the last one is old enough
+    PreviewServer &preview = app.preview;
+    if (preview.fence != 0)
+    {
+        if (glClientWaitSync(preview.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            return;
+        }
+        glDeleteSync(preview.fence);
+        preview.fence = 0;
+        size_t size = (size_t)preview.width * preview.height * 3;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, preview.buffer);
+        uint8_t *pixels = (uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (pixels != NULL)
+        {
+            std::lock_guard<std::mutex> lock(preview.mutex);
+            preview.frame.assign(pixels, pixels + size);
+            preview.frame_ready = true;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    double now = glfwGetTime();
+    if (preview.num_clients.load() == 0 || now - preview.last_request < preview.interval)
+    {
+        return;
+    }
+    preview.last_request = now;
+
+    // Scale the saved image down on the GPU (resolving the window's back buffer first), then read it back asynchronously
+    int image_width, layer_height, num_layers;
+    getSavedImageSize(app, image_width, layer_height, num_layers);
+    GLuint source_framebuffer = app.framebuffer;
+#ifndef OFFSCREEN
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, preview.resolve_framebuffer);
+    glBlitFramebuffer(0, 0, image_width, layer_height, 0, 0, image_width, layer_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    source_framebuffer = preview.resolve_framebuffer;
+#endif
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, preview.framebuffer);
+    glBlitFramebuffer(0, 0, image_width, layer_height, 0, 0, preview.width, preview.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, preview.framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, preview.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, preview.width, preview.height, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
+    preview.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void runPreviewServer(PreviewServer *preview)
+{
+    // Accept viewers and send each new preview to all of them as one JPEG part of a multipart stream
+#ifndef _WIN32
+#ifdef SCHED_IDLE
+    struct sched_param priority;
+    priority.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &priority);
+#endif
+    std::vector<uint8_t> frame, jpeg;
+    while (!preview->stopping.load())
+    {
+        struct pollfd listener;
+        listener.fd = preview->listen_socket;
+        listener.events = POLLIN;
+        if (poll(&listener, 1, 50) > 0)
+        {
+            int client = accept(preview->listen_socket, NULL, NULL);
+            if (client >= 0)
+            {
+                acceptPreviewClient(client, *preview);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(preview->mutex);
+            if (!preview->frame_ready)
+            {
+                continue;
+            }
+            frame.swap(preview->frame);
+            preview->frame_ready = false;
+        }
+        if (!encodeJpeg(frame.data(), preview->width, preview->height, preview->quality, jpeg))
+        {
+            continue;
+        }
+        char part_header[128];
+        int part_header_size = snprintf(part_header, sizeof(part_header), "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                                        jpeg.size());
+        size_t i = 0;
+        while (i < preview->clients.size())
+        {
+            int client = preview->clients[i];
+            if (sendAll(client, part_header, part_header_size) && sendAll(client, jpeg.data(), jpeg.size()) && sendAll(client, "\r\n", 2))
+            {
+                i++;
+                continue;
+            }
+            // viewer went away (or stalled past the send timeout)
+            close(client);
+            preview->clients.erase(preview->clients.begin() + i);
+            preview->num_clients.store(preview->clients.size());
+        }
+        preview->num_sent++;
+    }
+    size_t i;
+    for (i = 0; i < preview->clients.size(); i++)
+    {
+        close(preview->clients[i]);
+    }
+    preview->clients.clear();
+#endif
+}
+
+void acceptPreviewClient(int client, PreviewServer &preview)
+{
+    // Minimal HTTP: `/stream` is the MJPEG stream, `/` a page showing it, anything else is not found
+#ifndef _WIN32
+    struct timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+    {
+        ssize_t size = recv(client, chunk, sizeof(chunk), 0);
+        if (size <= 0)
+        {
+            close(client);
+            return;
+        }
+        request.append(chunk, size);
+    }
+    std::string path = "";
+    if (request.compare(0, 4, "GET ") == 0)
+    {
+        path = request.substr(4, request.find(' ', 4) - 4);
+    }
+    if (path == "/stream")
+    {
+        const char *response = "HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\nConnection: close\r\n"
+                               "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n";
+        if (sendAll(client, response, strlen(response)))
+        {
+            preview.clients.push_back(client);
+            preview.num_clients.store(preview.clients.size());
+            return;
+        }
+    }
+    else if (path == "/")
+    {
+        const char *response = "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nConnection: close\r\n\r\n"
+                               "<!DOCTYPE html><title>OmniStereo</title><body style=\"margin:0;background:#000\">"
+                               "<img src=\"/stream\" style=\"width:100%\"></body>\n";
+        sendAll(client, response, strlen(response));
+    }
+    else
+    {
+        const char *response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(client, response, strlen(response));
+    }
+    close(client);
+#endif
+}
+
+bool sendAll(int socket, const void *data, size_t size)
+{
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+    const char *bytes = (const char*)data;
+    while (size > 0)
+    {
+        ssize_t sent = send(socket, bytes, size, flags);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool encodeJpeg(const uint8_t *pixels, int width, int height, int quality, std::vector<uint8_t> &jpeg)
+{
+    // Baseline JPEG in memory from RGB rows bottom-up. Errors return here instead of exiting (libjpeg's default), so a
+    // failed preview frame is dropped without stopping the render
+    struct jpeg_compress_struct compressor;
+    memset(&compressor, 0, sizeof(compressor));
+    JpegErrorManager error_manager;
+    compressor.err = jpeg_std_error(&(error_manager.manager));
+    error_manager.manager.error_exit = exitJpegError;
+    unsigned char *output = NULL;
+    unsigned long output_size = 0;
+    if (setjmp(error_manager.escape))
+    {
+        jpeg_destroy_compress(&compressor);
+        free(output);
+        return false;
+    }
+    jpeg_create_compress(&compressor);
+    jpeg_mem_dest(&compressor, &output, &output_size);
+    compressor.image_width = width;
+    compressor.image_height = height;
+    compressor.input_components = 3;
+    compressor.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&compressor);
+    jpeg_set_quality(&compressor, quality, TRUE);
+    jpeg_start_compress(&compressor, TRUE);
+    while (compressor.next_scanline < compressor.image_height)
+    {
+        JSAMPROW row = (JSAMPROW)(pixels + (size_t)(height - 1 - compressor.next_scanline) * width * 3);
+        jpeg_write_scanlines(&compressor, &row, 1);
+    }
+    jpeg_finish_compress(&compressor);
+    jpeg.assign(output, output + output_size);
+    jpeg_destroy_compress(&compressor);
+    free(output);
+    return true;
+}
+
+void exitJpegError(j_common_ptr compressor)
+{
+    // Report the libjpeg error and unwind to the `setjmp` in `encodeJpeg`
+    (*compressor->err->output_message)(compressor);
+    longjmp(((JpegErrorManager*)compressor->err)->escape, 1);
+}
+
+void finishPreviewServer(App &app)
+{
+    PreviewServer &preview = app.preview;
+#ifndef _WIN32
+    preview.stopping.store(true);
+    preview.thread.join();
+    close(preview.listen_socket);
+    if (preview.fence != 0)
+    {
+        glDeleteSync(preview.fence);
+        preview.fence = 0;
+    }
+    printf("Preview sent %u frames\n", preview.num_sent);
+#endif
+}
+
+void writeImage(const char *filename, uint8_t *pixels, int image_width, int layer_height, int num_layers, bool bgra, bool top_down)
+{
+    // Binary PPM, rows flipped to top-down per layer unless already converted (BGRA pixels are repacked to RGB one row at a time)
+    int i, x, layer;
+    int bytes_per_pixel = bgra ? 4 : 3;
+    uint8_t *row = new uint8_t[image_width * 3];
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "Error: cannot open " << filename << std::endl;
+        delete[] row;
+        return;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    fprintf(fp, "P6\n%d %d\n255\n", image_width, layer_height * num_layers);
+    for (layer = 0; layer < num_layers; layer++) {
+        uint8_t *layer_pixels = pixels + ((size_t)layer * layer_height * image_width * bytes_per_pixel);
+        for (i = layer_height - 1; i >= 0; i --) {
+            uint8_t *src = layer_pixels + ((size_t)(top_down ? layer_height - 1 - i : i) * image_width * bytes_per_pixel);
+            if (bgra) {
+                for (x = 0; x < image_width; x++) {
+                    row[3 * x + 0] = src[4 * x + 2];
+                    row[3 * x + 1] = src[4 * x + 1];
+                    row[3 * x + 2] = src[4 * x + 0];
+                }
+                src = row;
+            }
+            fwrite(src, sizeof(uint8_t), image_width * 3, fp);
+        }
+    }
+    fclose(fp);
+    delete[] row;
+}
+
+const uint8_t* frameRow(const uint8_t *pixels, int row, int bytes_per_pixel, bool top_down, int image_width, int layer_height)
+{
+    // Row of the saved image counted top-down (read back rows are bottom-up per layer unless converted on the GPU)
+    if (!top_down)
+    {
+        row = (row / layer_height) * layer_height + layer_height - 1 - (row % layer_height);
+    }
+    return pixels + (size_t)row * image_width * bytes_per_pixel;
+}
+
+void runEncoderStripes(int num_stripes, EncoderPool &pool, const std::function<void(int)> &encode_stripe)
+{
+    // Stripes are handed out in order to the calling thread and the pool's encoder threads, the batch lives on this
+    // stack until all of its stripes are done
+    EncoderBatch batch;
+    batch.num_stripes = num_stripes;
+    batch.next_stripe = 0;
+    batch.num_done = 0;
+    batch.encode_stripe = &encode_stripe;
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    if (num_stripes > 1 && !pool.threads.empty())
+    {
+        pool.batches.push_back(&batch);
+        pool.stripe_ready.notify_all();
+    }
+    while (batch.next_stripe < batch.num_stripes)
+    {
+        int stripe = batch.next_stripe++;
+        if (batch.next_stripe == batch.num_stripes)
+        {
+            pool.batches.erase(std::remove(pool.batches.begin(), pool.batches.end(), &batch), pool.batches.end());
+        }
+        lock.unlock();
+        encode_stripe(stripe);
+        lock.lock();
+        batch.num_done++;
+    }
+    pool.batch_done.wait(lock, [&batch] { return batch.num_done == batch.num_stripes; });
+}
+
+void runEncoderPool(EncoderPool *pool)
+{
+    // Help with the oldest batch until the pool stops
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while (true)
+    {
+        pool->stripe_ready.wait(lock, [pool] { return !pool->batches.empty() || pool->stopping; });
+        if (pool->batches.empty())
+        {
+            return;
+        }
+        EncoderBatch *batch = pool->batches.front();
+        int stripe = batch->next_stripe++;
+        if (batch->next_stripe == batch->num_stripes)
+        {
+            pool->batches.pop_front();
+        }
+        lock.unlock();
+        (*batch->encode_stripe)(stripe);
+        lock.lock();
+        if (++batch->num_done == batch->num_stripes)
+        {
+            pool->batch_done.notify_all();
+        }
+    }
+}
+
+uint64_t writePng(const char *filename, uint8_t *pixels, int image_width, int height, bool bgra, bool top_down, int layer_height, FrameWriter &writer)
+{
+    // 8-bit RGB PNG, filtered and deflated in stripes of PNG_STRIPE_ROWS rows in parallel. Every stripe is primed with
+    // the last 32 KB of the rows before it and ends on a byte boundary (sync flush), so the pieces join into one zlib
+    // stream that compresses almost as well as a sequential one
+    int width = image_width;
+    int bytes_per_pixel = bgra ? 4 : 3;
+    size_t row_bytes = (size_t)width * 3;
+    size_t filtered_row_bytes = row_bytes + 1;
+    int num_stripes = (height + PNG_STRIPE_ROWS - 1) / PNG_STRIPE_ROWS;
+    int dictionary_rows = (int)((32768 + filtered_row_bytes - 1) / filtered_row_bytes);
+    std::vector<std::vector<uint8_t> > stripes(num_stripes);
+    std::vector<uLong> checksums(num_stripes);
+    runEncoderStripes(num_stripes, writer.encoders, [&](int stripe)
+    {
+        int start_row = stripe * PNG_STRIPE_ROWS;
+        int end_row = std::min(start_row + PNG_STRIPE_ROWS, height);
+        int first_row = std::max(start_row - dictionary_rows, 0);
+        std::vector<uint8_t> filtered((size_t)(end_row - first_row) * filtered_row_bytes);
+        std::vector<uint8_t> rgb_rows[2] = {std::vector<uint8_t>(row_bytes, 0), std::vector<uint8_t>(row_bytes, 0)};
+        const uint8_t *previous_row = rgb_rows[(first_row + 1) % 2].data();
+        int row, x;
+        for (row = std::max(first_row - 1, 0); row < end_row; row++)
+        {
+            const uint8_t *src = frameRow(pixels, row, bytes_per_pixel, top_down, width, layer_height);
+            if (bgra)
+            {
+                uint8_t *rgb = rgb_rows[row % 2].data();
+                for (x = 0; x < width; x++)
+                {
+                    rgb[3 * x + 0] = src[4 * x + 2];
+                    rgb[3 * x + 1] = src[4 * x + 1];
+                    rgb[3 * x + 2] = src[4 * x + 0];
+                }
+                src = rgb;
+            }
+            if (row >= first_row)
+            {
+                filterPngRow(src, previous_row, row_bytes, writer.png_filter, filtered.data() + (size_t)(row - first_row) * filtered_row_bytes);
+            }
+            previous_row = src;
+        }
+
+        size_t dictionary_size = (size_t)(start_row - first_row) * filtered_row_bytes;
+        size_t input_size = filtered.size() - dictionary_size;
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        int result = deflateInit2(&stream, writer.compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if (result == Z_OK && dictionary_size > 0)
+        {
+            size_t window_size = std::min(dictionary_size, (size_t)32768);
+            result = deflateSetDictionary(&stream, filtered.data() + dictionary_size - window_size, window_size);
+        }
+        std::vector<uint8_t> &compressed = stripes[stripe];
+        compressed.resize(deflateBound(&stream, input_size) + 16);
+        stream.next_in = filtered.data() + dictionary_size;
+        stream.avail_in = input_size;
+        stream.next_out = compressed.data();
+        stream.avail_out = compressed.size();
+        if (result == Z_OK)
+        {
+            // the output is sized by `deflateBound`, so one call consumes the whole stripe
+            result = deflate(&stream, (stripe == num_stripes - 1) ? Z_FINISH : Z_SYNC_FLUSH);
+            result = (result == ((stripe == num_stripes - 1) ? Z_STREAM_END : Z_OK) && stream.avail_in == 0) ? Z_OK : Z_BUF_ERROR;
+        }
+        if (result != Z_OK)
+        {
+            std::cerr << "Error: cannot compress stripe " << stripe << " of " << filename << std::endl;
+            exit(1);
+        }
+        compressed.resize(compressed.size() - stream.avail_out);
+        deflateEnd(&stream);
+        checksums[stripe] = adler32(adler32(0L, Z_NULL, 0), filtered.data() + dictionary_size, input_size);
+    });
+
+    // zlib header in front of the first stripe, checksum of all filtered rows after the last
+    uLong checksum = adler32(0L, Z_NULL, 0);
+    int i;
+    for (i = 0; i < num_stripes; i++)
+    {
+        int num_rows = std::min(PNG_STRIPE_ROWS, height - i * PNG_STRIPE_ROWS);
+        checksum = adler32_combine(checksum, checksums[i], (z_off_t)num_rows * filtered_row_bytes);
+    }
+    uint8_t zlib_header[2] = {0x78, 0x9C};
+    stripes[0].insert(stripes[0].begin(), zlib_header, zlib_header + 2);
+    stripes[num_stripes - 1].resize(stripes[num_stripes - 1].size() + 4);
+    storeBigEndian32(stripes[num_stripes - 1].data() + stripes[num_stripes - 1].size() - 4, checksum);
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "Error: cannot open " << filename << std::endl;
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t image_header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, 2, 0, 0, 0}; // 8-bit RGB, not interlaced
+    storeBigEndian32(image_header, width);
+    storeBigEndian32(image_header + 4, height);
+    fwrite(signature, sizeof(uint8_t), 8, fp);
+    uint64_t num_bytes = 8 + writePngChunk(fp, "IHDR", image_header, 13);
+    for (i = 0; i < num_stripes; i++)
+    {
+        num_bytes += writePngChunk(fp, "IDAT", stripes[i].data(), stripes[i].size());
+    }
+    num_bytes += writePngChunk(fp, "IEND", NULL, 0);
+    fclose(fp);
+    return num_bytes;
+}
+
+void filterPngRow(const uint8_t *row, const uint8_t *previous_row, size_t row_bytes, int filter, uint8_t *filtered)
+{
+    // Adaptive filtering picks the filter with the smallest sum of absolute (signed) residuals, like libpng,
+    // `filtered` starts with the filter type
+    uint64_t sums[5] = {0, 0, 0, 0, 0};
+    size_t i;
+    for (i = 0; i < row_bytes && filter == PNG_FILTER_ADAPTIVE; i++)
+    {
+        int left = (i >= 3) ? row[i - 3] : 0;
+        int up = previous_row[i];
+        int up_left = (i >= 3) ? previous_row[i - 3] : 0;
+        sums[0] += abs((int8_t)row[i]);
+        sums[1] += abs((int8_t)(row[i] - left));
+        sums[2] += abs((int8_t)(row[i] - up));
+        sums[3] += abs((int8_t)(row[i] - ((left + up) >> 1)));
+        sums[4] += abs((int8_t)(row[i] - paethPredictor(left, up, up_left)));
+    }
+    if (filter == PNG_FILTER_ADAPTIVE)
+    {
+        filter = 0;
+        int j;
+        for (j = 1; j < 5; j++)
+        {
+            if (sums[j] < sums[filter])
+            {
+                filter = j;
+            }
+        }
+    }
+
+    filtered[0] = (uint8_t)filter;
+    for (i = 0; i < row_bytes; i++)
+    {
+        int left = (i >= 3) ? row[i - 3] : 0;
+        int up = previous_row[i];
+        int up_left = (i >= 3) ? previous_row[i - 3] : 0;
+        int prediction = 0;
+        if (filter == 1) prediction = left;
+        else if (filter == 2) prediction = up;
+        else if (filter == 3) prediction = (left + up) >> 1;
+        else if (filter == 4) prediction = paethPredictor(left, up, up_left);
+        filtered[i + 1] = (uint8_t)(row[i] - prediction);
+    }
+}
+
+int paethPredictor(int left, int up, int up_left)
+{
+    int estimate = left + up - up_left;
+    int left_distance = abs(estimate - left);
+    int up_distance = abs(estimate - up);
+    int up_left_distance = abs(estimate - up_left);
+    if (left_distance <= up_distance && left_distance <= up_left_distance)
+    {
+        return left;
+    }
+    return (up_distance <= up_left_distance) ? up : up_left;
+}
+
+uint64_t writePngChunk(FILE *fp, const char *type, const uint8_t *data, size_t size)
+{
+    // Length, type, data and CRC of type and data (big-endian)
+    uint8_t length[4];
+    uint8_t crc[4];
+    uLong checksum = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)type, 4);
+    if (size > 0)
+    {
+        checksum = crc32(checksum, data, size);
+    }
+    storeBigEndian32(length, size);
+    storeBigEndian32(crc, checksum);
+    fwrite(length, sizeof(uint8_t), 4, fp);
+    fwrite(type, sizeof(uint8_t), 4, fp);
+    fwrite(data, sizeof(uint8_t), size, fp);
+    fwrite(crc, sizeof(uint8_t), 4, fp);
+    return size + 12;
+}
+
+void storeBigEndian32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+uint64_t writeExr(const char *filename, uint8_t *pixels, int image_width, int height, bool bgra, bool top_down, int layer_height,
+                  const uint8_t *distances, FrameWriter &writer)
+{
+    // Scanline OpenEXR with half-float B, G, R (linearized sRGB) and optionally float Z (distance to the camera),
+    // ZIP compressed in independent chunks of EXR_BLOCK_ROWS rows that are encoded in parallel (little-endian hosts)
+    int width = image_width;
+    int bytes_per_pixel = bgra ? 4 : 3;
+    int red = bgra ? 2 : 0;
+    int blue = bgra ? 0 : 2;
+    size_t row_size = (size_t)width * (3 * sizeof(uint16_t) + ((distances != NULL) ? sizeof(float) : 0));
+    int num_blocks = (height + EXR_BLOCK_ROWS - 1) / EXR_BLOCK_ROWS;
+    std::vector<std::vector<uint8_t> > blocks(num_blocks);
+    runEncoderStripes(num_blocks, writer.encoders, [&](int block)
+    {
+        int start_row = block * EXR_BLOCK_ROWS;
+        int end_row = std::min(start_row + EXR_BLOCK_ROWS, height);
+        std::vector<uint8_t> raw((end_row - start_row) * row_size);
+        uint8_t *dst = raw.data();
+        int row, x;
+        for (row = start_row; row < end_row; row++)
+        {
+            // channels one after another within each row, in alphabetical order
+            const uint8_t *src = frameRow(pixels, row, bytes_per_pixel, top_down, width, layer_height);
+            uint16_t *b = (uint16_t*)dst;
+            uint16_t *g = b + width;
+            uint16_t *r = g + width;
+            for (x = 0; x < width; x++)
+            {
+                b[x] = writer.srgb_to_half[src[x * bytes_per_pixel + blue]];
+                g[x] = writer.srgb_to_half[src[x * bytes_per_pixel + 1]];
+                r[x] = writer.srgb_to_half[src[x * bytes_per_pixel + red]];
+            }
+            dst += (size_t)width * 3 * sizeof(uint16_t);
+            if (distances != NULL)
+            {
+                memcpy(dst, frameRow(distances, row, sizeof(float), false, width, layer_height), (size_t)width * sizeof(float));
+                dst += (size_t)width * sizeof(float);
+            }
+        }
+
+        // ZIP compression: low and high bytes split into two halves, then byte deltas, then zlib
+        std::vector<uint8_t> predicted(raw.size());
+        size_t half_size = (raw.size() + 1) / 2;
+        size_t i;
+        for (i = 0; i < raw.size(); i++)
+        {
+            predicted[(i % 2 == 0) ? i / 2 : half_size + i / 2] = raw[i];
+        }
+        int previous = predicted[0];
+        for (i = 1; i < predicted.size(); i++)
+        {
+            int value = predicted[i];
+            predicted[i] = (uint8_t)(value - previous + 128);
+            previous = value;
+        }
+        std::vector<uint8_t> &chunk = blocks[block];
+        uLongf compressed_size = compressBound(predicted.size());
+        chunk.resize(2 * sizeof(int32_t) + compressed_size);
+        if (compress2(chunk.data() + 2 * sizeof(int32_t), &compressed_size, predicted.data(), predicted.size(), writer.compression_level) != Z_OK)
+        {
+            std::cerr << "Error: cannot compress rows " << start_row << " to " << end_row << " of " << filename << std::endl;
+            exit(1);
+        }
+        if (compressed_size >= raw.size())
+        {
+            // incompressible chunks are stored as they are
+            compressed_size = raw.size();
+            memcpy(chunk.data() + 2 * sizeof(int32_t), raw.data(), raw.size());
+        }
+        chunk.resize(2 * sizeof(int32_t) + compressed_size);
+        int32_t chunk_header[2] = {start_row, (int32_t)compressed_size};
+        memcpy(chunk.data(), chunk_header, sizeof(chunk_header));
+    });
+
+    std::vector<uint8_t> header;
+    const uint8_t magic_version[8] = {0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0};
+    header.insert(header.end(), magic_version, magic_version + 8);
+    std::vector<uint8_t> channels;
+    const char *channel_names[4] = {"B", "G", "R", "Z"};
+    int i;
+    for (i = 0; i < ((distances != NULL) ? 4 : 3); i++)
+    {
+        // name, pixel type (1 half, 2 float), linear flag and reserved bytes, x and y sampling
+        int32_t channel[4] = {(i == 3) ? 2 : 1, 0, 1, 1};
+        channels.insert(channels.end(), channel_names[i], channel_names[i] + 2);
+        channels.insert(channels.end(), (uint8_t*)channel, (uint8_t*)(channel + 4));
+    }
+    channels.push_back(0);
+    appendExrAttribute(header, "channels", "chlist", channels.data(), channels.size());
+    uint8_t compression = 3; // ZIP_COMPRESSION
+    appendExrAttribute(header, "compression", "compression", &compression, 1);
+    int32_t window[4] = {0, 0, width - 1, height - 1};
+    appendExrAttribute(header, "dataWindow", "box2i", window, sizeof(window));
+    appendExrAttribute(header, "displayWindow", "box2i", window, sizeof(window));
+    uint8_t line_order = 0; // INCREASING_Y
+    appendExrAttribute(header, "lineOrder", "lineOrder", &line_order, 1);
+    float aspect_ratio = 1.0f;
+    appendExrAttribute(header, "pixelAspectRatio", "float", &aspect_ratio, sizeof(float));
+    float window_center[2] = {0.0f, 0.0f};
+    appendExrAttribute(header, "screenWindowCenter", "v2f", window_center, sizeof(window_center));
+    float window_width = 1.0f;
+    appendExrAttribute(header, "screenWindowWidth", "float", &window_width, sizeof(float));
+    header.push_back(0);
+
+    // Offset table, one entry per chunk
+    uint64_t offset = header.size() + num_blocks * sizeof(uint64_t);
+    for (i = 0; i < num_blocks; i++)
+    {
+        header.insert(header.end(), (uint8_t*)&offset, (uint8_t*)(&offset + 1));
+        offset += blocks[i].size();
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "Error: cannot open " << filename << std::endl;
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    fwrite(header.data(), sizeof(uint8_t), header.size(), fp);
+    for (i = 0; i < num_blocks; i++)
+    {
+        fwrite(blocks[i].data(), sizeof(uint8_t), blocks[i].size(), fp);
+    }
+    fclose(fp);
+    return offset;
+}
+
+uint64_t writeDistance(const char *filename, const uint8_t *distances, int image_width, int height, int layer_height)
+{
+    // Portable float map (little-endian, rows bottom-up) of the distance target
+    int width = image_width;
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "Error: cannot open " << filename << std::endl;
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    fprintf(fp, "Pf\n%d %d\n-1.0\n", width, height);
+    int row;
+    for (row = height - 1; row >= 0; row--)
+    {
+        fwrite(frameRow(distances, row, sizeof(float), false, width, layer_height), sizeof(float), width, fp);
+    }
+    uint64_t num_bytes = ftell(fp);
+    fclose(fp);
+    return num_bytes;
+}
+
+void appendExrAttribute(std::vector<uint8_t> &header, const char *name, const char *type, const void *value, int32_t size)
+{
+    // Name and type (null terminated), size, value
+    header.insert(header.end(), name, name + strlen(name) + 1);
+    header.insert(header.end(), type, type + strlen(type) + 1);
+    header.insert(header.end(), (uint8_t*)&size, (uint8_t*)(&size + 1));
+    header.insert(header.end(), (const uint8_t*)value, (const uint8_t*)value + size);
+}
+
+uint16_t floatToHalf(float value)
+{
+    // Round to nearest, overflow to infinity (no NaN handling needed for colors and distances)
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent <= 0)
+    {
+        // subnormal half (or zero)
+        if (exponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint16_t half = (uint16_t)(mantissa >> shift);
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            half++;
+        }
+        return sign | half;
+    }
+    if (exponent >= 31)
+    {
+        return sign | 0x7C00;
+    }
+    uint16_t half = sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        half++;
+    }
+    return half;
+}
+
+void initializeFrameWriter(App &app)
+{
+    // Pooled frame buffers (big enough for either readback layout, the depth channel and the output pyramid) double as
+    // the bound on the queue
+    FrameWriter &writer = app.writer;
+    getSavedImageSize(app, writer.image_width, writer.layer_height, writer.num_layers);
+    size_t size = (size_t)writer.image_width * writer.layer_height * writer.num_layers * (writer.depth ? 8 : 4) + outputPyramidPixels(app) * 4 +
+                  (app.delta.enabled ? (size_t)app.delta.tiles_x * app.delta.tiles_y : 0);
+    int i;
+    for (i = 0; i < writer.queue_size; i++)
+    {
+        writer.buffers.push_back(new uint8_t[size]);
+    }
+    writer.free_buffers = writer.buffers;
+    writer.next_sequence = 0;
+    writer.next_write_sequence = 0;
+    writer.converted = app.conversion.enabled;
+    if (writer.format == OUTPUT_EXR)
+    {
+        // 8-bit sRGB to linear half float
+        for (i = 0; i < 256; i++)
+        {
+            float value = i / 255.0f;
+            writer.srgb_to_half[i] = floatToHalf((value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f));
+        }
+    }
+    if (writer.format == OUTPUT_Y4M || writer.format == OUTPUT_YUV)
+    {
+        // 4:2:0 needs even dimensions, the stream header goes out before any frame
+        if (writer.image_width % 2 != 0 || (writer.layer_height * writer.num_layers) % 2 != 0)
+        {
+            std::cerr << "Error: video output needs an even width and height" << std::endl;
+            exit(1);
+        }
+        if (writer.format == OUTPUT_Y4M)
+        {
+            fprintf(writer.stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", writer.image_width,
+                    writer.layer_height * writer.num_layers, writer.stream_fps);
+        }
+    }
+    if (writer.format == OUTPUT_DELTA)
+    {
+        fprintf(writer.stream, "OMNIDELTA W%d H%d T%d\n", writer.image_width, writer.layer_height * writer.num_layers, writer.delta_tile_size);
+    }
+    writer.tiles_changed = 0;
+    writer.tiles_total = 0;
+    writer.stopping = false;
+    writer.num_written = 0;
+    writer.num_dropped = 0;
+    writer.max_queue_depth = 0;
+    writer.bytes_written = 0;
+    writer.report_bytes_written = 0;
+    writer.start_time = glfwGetTime();
+    writer.encoders.stopping = false;
+    if (writer.format == OUTPUT_PNG || writer.format == OUTPUT_EXR)
+    {
+        // Each frame is encoded by its writer thread plus these
+        for (i = 1; i < writer.encoder_threads; i++)
+        {
+            writer.encoders.threads.push_back(std::thread(runEncoderPool, &writer.encoders));
+        }
+    }
+    for (i = 0; i < writer.num_threads; i++)
+    {
+        writer.threads.push_back(std::thread(runFrameWriter, &writer));
+    }
+}
+
+uint8_t* acquireFrameBuffer(App &app)
+{
+    // Back-pressure: wait for a writer to return a buffer, or drop the frame (NULL)
+    FrameWriter &writer = app.writer;
+    std::unique_lock<std::mutex> lock(writer.mutex);
+    if (writer.free_buffers.empty() && writer.drop_frames)
+    {
+        writer.num_dropped++;
+        return NULL;
+    }
+    writer.buffer_free.wait(lock, [&writer] { return !writer.free_buffers.empty(); });
+    uint8_t *pixels = writer.free_buffers.back();
+    writer.free_buffers.pop_back();
+    return pixels;
+}
+
+void submitFrameWrite(const char *filename, uint8_t *pixels, bool bgra, App &app)
+{
+    FrameWriter &writer = app.writer;
+    FrameWriteJob job;
+    job.filename = filename;
+    job.pixels = pixels;
+    job.bgra = bgra;
+    job.sequence = writer.next_sequence++;
+    if (writer.num_threads == 0)
+    {
+        // no workers - write on the render thread
+        writeFrame(job, writer.stream_frame, writer);
+        return;
+    }
 
-    initializeUniforms(camera_offset, app);
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.jobs.push_back(job);
+    writer.max_queue_depth = std::max(writer.max_queue_depth, writer.jobs.size());
+    writer.job_ready.notify_one();
 }
 
-void initializeScene(const char *scene_filename, App &app)
+void runFrameWriter(FrameWriter *writer)
 {
-    const int NONE = -1;
-    const int CAMERA = 0;
-    const int LIGHTS = 1;
-    const int POINTS = 2;
+    // Worker thread: encode and write queued frames until the writer stops and the queue is empty
+    std::vector<uint8_t> stream_frame;
+    while (true)
+    {
+        FrameWriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(writer->mutex);
+            writer->job_ready.wait(lock, [writer] { return writer->stopping || !writer->jobs.empty(); });
+            if (writer->jobs.empty())
+            {
+                return;
+            }
+            job = writer->jobs.front();
+            writer->jobs.pop_front();
+        }
 
-    std::cout << "Reading scene file" << std::endl;
+        writeFrame(job, stream_frame, *writer);
+    }
+}
 
-    std::ifstream scene_file(scene_filename);
-    std::string line;
-    int section = NONE;
-    int light_count, point_count, light_idx = 0, point_idx = 0;
-    GLfloat *point_centers, *point_colors, *point_sizes;
-    float x, y, z, size, red, green, blue;
-    int skip = 1; // 1 out ouf every `skip` points will be rendered
-    while (std::getline(scene_file, line))
+void writeFrame(FrameWriteJob &job, std::vector<uint8_t> &stream_frame, FrameWriter &writer)
+{
+    // Encode and write one frame, then return its buffer to the pool (video streams are converted in parallel
+    // but appended strictly in frame order)
+    uint64_t num_bytes;
+    if (writer.format == OUTPUT_Y4M || writer.format == OUTPUT_YUV || writer.format == OUTPUT_DELTA)
     {
-        // start of camera data
-        if (line.length() > 0 && line[0] == 'c')
+        // frames converted on the GPU are already I420 and are written straight from their buffer, everything
+        // else is encoded into the stream frame first so the buffer can go back to the pool before waiting
+        bool direct = writer.converted && writer.format != OUTPUT_DELTA;
+        uint8_t *frame_data = job.pixels;
+        uint32_t tiles_changed = 0;
+        uint32_t num_tiles = 0;
+        if (writer.format == OUTPUT_DELTA)
         {
-            section = CAMERA;
+            tiles_changed = encodeTileDelta(job.pixels, job.bgra, stream_frame, num_tiles, writer);
+            num_bytes = stream_frame.size();
+            frame_data = stream_frame.data();
         }
-        // start of lights data
-        else if (line.length() > 0 && line[0] == 'l')
+        else
         {
-            std::istringstream iss(line);
-            std::string name;
-            iss >> name >> light_count;
-            app.scene.ambient_light = glm::vec3(0.25, 0.25, 0.25);
-            app.scene.num_lights = light_count;
-            app.scene.light_positions = new GLfloat[3 * app.scene.num_lights];
-            app.scene.light_colors = new GLfloat[3 * app.scene.num_lights];
-            section = LIGHTS;
+            num_bytes = (uint64_t)writer.image_width * writer.layer_height * writer.num_layers * 3 / 2;
+            if (!direct)
+            {
+                stream_frame.resize(num_bytes);
+                convertToYuv420(job.pixels, job.bgra, writer.image_width, writer.layer_height, writer.num_layers, stream_frame.data());
+                frame_data = stream_frame.data();
+            }
         }
-        // start of points data
-        else if (line.length() > 0 && line[0] == 'p')
+
+        std::unique_lock<std::mutex> lock(writer.mutex);
+        if (!direct)
         {
-            std::istringstream iss(line);
-            std::string name;
-            iss >> name >> point_count;
-            app.scene.num_points = (point_count - 1) / skip + 1;
-            point_centers = new GLfloat[3 * app.scene.num_points];
-            point_colors = new GLfloat[3 * app.scene.num_points];
-            point_sizes = new GLfloat[app.scene.num_points];
-            section = POINTS;
+            writer.free_buffers.push_back(job.pixels);
+            writer.buffer_free.notify_one();
         }
-        // camera data
-        else if (line.length() > 0 && line[0] != '#' && section == CAMERA)
+        writer.stream_turn.wait(lock, [&writer, &job] { return writer.next_write_sequence == job.sequence; });
+        lock.unlock();
+        if (writer.format == OUTPUT_Y4M)
         {
-            std::istringstream iss(line);
-            iss >> x >> y >> z;
-            app.scene.camera_pos = glm::vec3(x, y, z);
+            fputs("FRAME\n", writer.stream);
         }
-        // light data
-        else if (line.length() > 0 && line[0] != '#' && section == LIGHTS)
+        fwrite(frame_data, sizeof(uint8_t), num_bytes, writer.stream);
+        lock.lock();
+        if (direct)
         {
-            std::istringstream iss(line);
-            iss >> x >> y >> z >> red >> green >> blue;
-            app.scene.light_positions[3 * light_idx] = x;
-            app.scene.light_positions[3 * light_idx + 1] = y;
-            app.scene.light_positions[3 * light_idx + 2] = z;
-            app.scene.light_colors[3 * light_idx] = red;
-            app.scene.light_colors[3 * light_idx + 1] = green;
-            app.scene.light_colors[3 * light_idx + 2] = blue;
-            light_idx++;
+            writer.free_buffers.push_back(job.pixels);
+            writer.buffer_free.notify_one();
         }
-        // point data
-        else if (line.length() > 0 && line[0] != '#' && section == POINTS)
+        writer.next_write_sequence++;
+        writer.stream_turn.notify_all();
+        writer.num_written++;
+        writer.bytes_written += num_bytes;
+        writer.tiles_changed += tiles_changed;
+        writer.tiles_total += num_tiles;
+        return;
+    }
+    size_t num_pixels = (size_t)writer.image_width * writer.layer_height * writer.num_layers;
+    int bytes_per_pixel = job.bgra ? 4 : 3;
+    const uint8_t *distances = writer.depth ? job.pixels + num_pixels * bytes_per_pixel : NULL;
+    num_bytes = writeFrameImage(job.filename.c_str(), job.pixels, writer.image_width, writer.layer_height, writer.num_layers, job.bgra,
+                                writer.converted, distances, writer);
+
+    // filtered levels follow the frame (and its distances) as single layer images with rows bottom-up
+    uint8_t *level_pixels = job.pixels + num_pixels * (bytes_per_pixel + (writer.depth ? sizeof(float) : 0));
+    std::string::size_type extension = job.filename.rfind('.');
+    size_t i;
+    for (i = 0; i < writer.pyramid_levels.size(); i++)
+    {
+        int level = writer.pyramid_levels[i];
+        int level_width = pyramidLevelSize(writer.image_width, level);
+        int level_height = pyramidLevelSize(writer.layer_height, level);
+        std::string level_filename = job.filename.substr(0, extension) + "_mip" + std::to_string(level) + job.filename.substr(extension);
+        num_bytes += writeFrameImage(level_filename.c_str(), level_pixels, level_width, level_height, 1, job.bgra, false, NULL, writer);
+        level_pixels += (size_t)level_width * level_height * bytes_per_pixel;
+    }
+
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.num_written++;
+    writer.bytes_written += num_bytes;
+    writer.free_buffers.push_back(job.pixels);
+    writer.buffer_free.notify_one();
+}
+
+uint64_t writeFrameImage(const char *filename, uint8_t *pixels, int image_width, int layer_height, int num_layers, bool bgra, bool top_down,
+                         const uint8_t *distances, FrameWriter &writer)
+{
+    // One image file in the writer's format, distances go into the `Z` channel of EXR files or a separate `<image>_depth.pfm`
+    uint64_t num_bytes;
+    int height = layer_height * num_layers;
+    if (writer.format == OUTPUT_PNG)
+    {
+        num_bytes = writePng(filename, pixels, image_width, height, bgra, top_down, layer_height, writer);
+    }
+    else if (writer.format == OUTPUT_EXR)
+    {
+        return writeExr(filename, pixels, image_width, height, bgra, top_down, layer_height, distances, writer);
+    }
+    else
+    {
+        writeImage(filename, pixels, image_width, layer_height, num_layers, bgra, top_down);
+        num_bytes = (uint64_t)image_width * height * 3;
+    }
+    if (distances != NULL)
+    {
+        std::string depth_filename = std::string(filename);
+        depth_filename = depth_filename.substr(0, depth_filename.rfind('.')) + "_depth.pfm";
+        num_bytes += writeDistance(depth_filename.c_str(), distances, image_width, height, layer_height);
+    }
+    return num_bytes;
+}
+
+uint32_t encodeTileDelta(const uint8_t *pixels, bool bgra, std::vector<uint8_t> &record, uint32_t &num_tiles, FrameWriter &writer)
+{
+    // "FRAME\n", one byte per tile from the top-left (1 if it changed since the previous frame), then the changed
+    // tiles in the same order as RGB rows top-down (tiles on the right and bottom edge are clipped to the image)
+    int width = writer.image_width;
+    int height = writer.layer_height * writer.num_layers;
+    int tile_size = writer.delta_tile_size;
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int tiles_y = (height + tile_size - 1) / tile_size;
+    int bytes_per_pixel = bgra ? 4 : 3;
+    const uint8_t *flags = pixels + (size_t)width * height * bytes_per_pixel;
+    const char *marker = "FRAME\n";
+    record.assign(marker, marker + strlen(marker));
+    uint32_t num_changed = 0;
+    int i, tile_x, tile_y, row, x;
+    for (i = 0; i < tiles_x * tiles_y; i++)
+    {
+        record.push_back((flags[i] != 0) ? 1 : 0);
+        num_changed += (flags[i] != 0) ? 1 : 0;
+    }
+    for (tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        for (tile_x = 0; tile_x < tiles_x; tile_x++)
         {
-            std::istringstream iss(line);
-            iss >> x >> y >> z >> size >> red >> green >> blue;
-            
-            if (point_idx % skip == 0)
+            if (flags[tile_y * tiles_x + tile_x] == 0)
             {
-                //if (point_idx >= app.scene.num_points) std::cout << "Oops - exceeded point count" << std::endl;
-                point_centers[3 * (point_idx / skip)] = x;
-                point_centers[3 * (point_idx / skip) + 1] = y;
-                point_centers[3 * (point_idx / skip) + 2] = z;
-                point_sizes[point_idx / skip] = size;
-                point_colors[3 * (point_idx / skip)] = red;
-                point_colors[3 * (point_idx / skip) + 1] = green;
-                point_colors[3 * (point_idx / skip) + 2] = blue;
+                continue;
+            }
+            int x0 = tile_x * tile_size;
+            int tile_width = std::min(tile_size, width - x0);
+            for (row = tile_y * tile_size; row < std::min((tile_y + 1) * tile_size, height); row++)
+            {
+                const uint8_t *src = frameRow(pixels, row, bytes_per_pixel, writer.converted, width, writer.layer_height) + x0 * bytes_per_pixel;
+                size_t offset = record.size();
+                record.resize(offset + tile_width * 3);
+                uint8_t *dst = record.data() + offset;
+                for (x = 0; x < tile_width; x++)
+                {
+                    dst[3 * x + 0] = src[bytes_per_pixel * x + (bgra ? 2 : 0)];
+                    dst[3 * x + 1] = src[bytes_per_pixel * x + 1];
+                    dst[3 * x + 2] = src[bytes_per_pixel * x + (bgra ? 0 : 2)];
+                }
             }
-            point_idx++;
         }
     }
-    std::cout << point_idx / skip << "/" << app.scene.num_points << std::endl;
-    app.scene.model.vertex_array = createPointCloudVao(point_centers, point_colors, point_sizes, app.scene.num_points, app.vertex_position_attrib,
-        app.vertex_normal_attrib, app.vertex_texcoord_attrib, app.point_center_attrib, app.point_color_attrib, app.point_size_attrib, &(app.scene.model.face_index_count));
-    delete[] point_centers;
-    delete[] point_colors;
-    delete[] point_sizes;
-
-    std::cout << "Finished" << std::endl;
-
-    /*
-    glm::vec3 camera_move_direction = glm::vec3(0.98348, -0.03766, 0.17702);
-    app.scene.camera_pos = app.scene.camera_pos - (-75.0f * camera_move_direction);
-
-    glm::vec3 f265 = app.scene.camera_pos + ((-0.2f * 265.0f) * camera_move_direction);
-    printf("frame 265 location: %.4f, %.4f, %.4f\n", f265[0], f265[1], f265[2]);
-    // frame 265
-    // move (260.6222, -9.9799, 46.9103)
+    num_tiles = tiles_x * tiles_y;
+    return num_changed;
+}
 
-    app.scene.camera_pos = app.scene.camera_pos + ((-0.2f * 264.0f) * camera_move_direction);
-    */
+void convertToYuv420(uint8_t *pixels, bool bgra, int image_width, int layer_height, int num_layers, uint8_t *yuv)
+{
+    // Planar I420 of the saved image (rows flipped to top-down per layer, like `writeImage`)
+    int bytes_per_pixel = bgra ? 4 : 3;
+    int height = layer_height * num_layers;
+    uint8_t *y_plane = yuv;
+    uint8_t *u_plane = y_plane + (size_t)image_width * height;
+    uint8_t *v_plane = u_plane + (size_t)(image_width / 2) * (height / 2);
+    int row;
+    for (row = 0; row < height; row += 2)
+    {
+        const uint8_t *src[2];
+        int i;
+        for (i = 0; i < 2; i++)
+        {
+            int layer = (row + i) / layer_height;
+            int layer_row = layer_height - 1 - ((row + i) % layer_height);
+            src[i] = pixels + ((size_t)layer * layer_height + layer_row) * image_width * bytes_per_pixel;
+        }
+        convertRowsToYuv420(src[0], src[1], image_width, bgra, y_plane + (size_t)row * image_width, y_plane + (size_t)(row + 1) * image_width,
+                            u_plane + (size_t)(row / 2) * (image_width / 2), v_plane + (size_t)(row / 2) * (image_width / 2));
+    }
 }
 
-void initializeUniforms(float camera_offset, App &app)
+void convertRowsToYuv420(const uint8_t *row0, const uint8_t *row1, int width, bool bgra, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
 {
-    glUseProgram(app.program);
+    // BT.601 limited range in 8.8 fixed point, chroma from the rounded 2x2 average (SSE2 and scalar paths give identical results)
+    int x = 0;
+#ifdef USE_SSE2
+    {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i ones = _mm_set1_epi16(1);
+        for (; x + 16 <= width; x += 16)
+        {
+            // 16 pixels of both rows as 16-bit R, G, B lanes (8 pixels per register)
+            __m128i r[2][2], g[2][2], b[2][2];
+            int i, j;
+            for (i = 0; i < 2; i++)
+            {
+                const uint8_t *src = ((i == 0) ? row0 : row1) + (bgra ? 4 : 3) * x;
+                for (j = 0; j < 2; j++)
+                {
+                    // 4 pixels per 32-bit lane group, RGB is spread out to the BGRA lane layout with R and B swapped
+                    __m128i p0 = bgra ? _mm_loadu_si128((const __m128i*)(src + 32 * j)) : loadRgbPixels(src + 24 * j, false);
+                    __m128i p1 = bgra ? _mm_loadu_si128((const __m128i*)(src + 32 * j + 16)) : loadRgbPixels(src + 24 * j + 12, j == 1);
+                    __m128i low = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+                    __m128i high = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+                    b[i][j] = bgra ? low : high;
+                    g[i][j] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+                    r[i][j] = bgra ? high : low;
+                }
+            }
 
-    glUniform1i(app.uniforms["num_lights"], app.scene.num_lights);
-    glUniform3fv(app.uniforms["light_ambient"], 1, glm::value_ptr(app.scene.ambient_light));
-    glUniform3fv(app.uniforms["light_position[0]"], app.scene.num_lights, app.scene.light_positions);
-    glUniform3fv(app.uniforms["light_color[0]"], app.scene.num_lights, app.scene.light_colors);
-    glUniform3fv(app.uniforms["camera_position"], 1, glm::value_ptr(app.scene.camera_pos));
-    glUniform1f(app.uniforms["camera_offset"], camera_offset);
+            // Luma (the weighted sum stays below 2^16, so unsigned 16-bit lanes are enough)
+            for (i = 0; i < 2; i++)
+            {
+                __m128i luma[2];
+                for (j = 0; j < 2; j++)
+                {
+                    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r[i][j], _mm_set1_epi16(66)), _mm_mullo_epi16(g[i][j], _mm_set1_epi16(129))),
+                                                _mm_add_epi16(_mm_mullo_epi16(b[i][j], _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+                    luma[j] = _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+                }
+                _mm_storeu_si128((__m128i*)(((i == 0) ? y0 : y1) + x), _mm_packus_epi16(luma[0], luma[1]));
+            }
 
-    glUseProgram(0);
+            // 2x2 averages (vertical sum, then horizontal pairs through `madd`)
+            __m128i r_avg = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(r[0][0], r[1][0]), ones),
+                                                                         _mm_madd_epi16(_mm_add_epi16(r[0][1], r[1][1]), ones)), _mm_set1_epi16(2)), 2);
+            __m128i g_avg = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(g[0][0], g[1][0]), ones),
+                                                                         _mm_madd_epi16(_mm_add_epi16(g[0][1], g[1][1]), ones)), _mm_set1_epi16(2)), 2);
+            __m128i b_avg = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(b[0][0], b[1][0]), ones),
+                                                                         _mm_madd_epi16(_mm_add_epi16(b[0][1], b[1][1]), ones)), _mm_set1_epi16(2)), 2);
+
+            // Chroma (signed sums stay within +/-2^15)
+            __m128i u_sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r_avg, _mm_set1_epi16(-38)), _mm_mullo_epi16(g_avg, _mm_set1_epi16(-74))),
+                                          _mm_add_epi16(_mm_mullo_epi16(b_avg, _mm_set1_epi16(112)), _mm_set1_epi16(128)));
+            __m128i v_sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r_avg, _mm_set1_epi16(112)), _mm_mullo_epi16(g_avg, _mm_set1_epi16(-94))),
+                                          _mm_add_epi16(_mm_mullo_epi16(b_avg, _mm_set1_epi16(-18)), _mm_set1_epi16(128)));
+            __m128i u_value = _mm_add_epi16(_mm_srai_epi16(u_sum, 8), _mm_set1_epi16(128));
+            __m128i v_value = _mm_add_epi16(_mm_srai_epi16(v_sum, 8), _mm_set1_epi16(128));
+            _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(u_value, u_value));
+            _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(v_value, v_value));
+        }
+    }
+#endif
+    int bytes_per_pixel = bgra ? 4 : 3;
+    int red = bgra ? 2 : 0;
+    int blue = bgra ? 0 : 2;
+    for (; x < width; x += 2)
+    {
+        int r_sum = 0, g_sum = 0, b_sum = 0;
+        int i, j;
+        for (i = 0; i < 2; i++)
+        {
+            for (j = 0; j < 2; j++)
+            {
+                const uint8_t *pixel = ((i == 0) ? row0 : row1) + (x + j) * bytes_per_pixel;
+                int r = pixel[red], g = pixel[1], b = pixel[blue];
+                ((i == 0) ? y0 : y1)[x + j] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                r_sum += r;
+                g_sum += g;
+                b_sum += b;
+            }
+        }
+        int r = (r_sum + 2) >> 2, g = (g_sum + 2) >> 2, b = (b_sum + 2) >> 2;
+        u[x / 2] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[x / 2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
 }
 
-void idle(GLFWwindow *window, App &app)
+#ifdef USE_SSE2
+__m128i loadRgbPixels(const uint8_t *pixels, bool last)
 {
-    // update camera
-    //glm::vec3 camera_move_direction = glm::vec3(0.98348, -0.03766, 0.17702);
-    //app.scene.camera_pos = app.scene.camera_pos + (-0.2f * camera_move_direction);
-    //glUseProgram(app.program);
-    //glUniform3fv(app.uniforms["camera_position"], 1, glm::value_ptr(app.scene.camera_pos));
-    //glUseProgram(0);
-
-    render(window, app);
+    // 4 packed RGB pixels (12 bytes) as 32-bit lanes with R in the low byte, pixel k shifted up by k bytes into lane k.
+    // The last group of a 16 pixel run is loaded 4 bytes early, so the load never reads past the run
+    __m128i packed = last ? _mm_srli_si128(_mm_loadu_si128((const __m128i*)(pixels - 4)), 4) : _mm_loadu_si128((const __m128i*)pixels);
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(packed, _mm_setr_epi32(0xFFFFFF, 0, 0, 0)),
+                                     _mm_and_si128(_mm_slli_si128(packed, 1), _mm_setr_epi32(0, 0xFFFFFF, 0, 0))),
+                        _mm_or_si128(_mm_and_si128(_mm_slli_si128(packed, 2), _mm_setr_epi32(0, 0, 0xFFFFFF, 0)),
+                                     _mm_and_si128(_mm_slli_si128(packed, 3), _mm_setr_epi32(0, 0, 0, 0xFFFFFF))));
 }
+#endif
 
-void render(GLFWwindow *window, App &app)
+void reportFrameWriter(double interval, App &app)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, app.framebuffer);
-
-    // Delete previous frame (reset both framebuffer and z-buffer)
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Select shader program to use
-    glUseProgram(app.program);
-
-    // Render
-    glBindVertexArray(app.scene.model.vertex_array);
-    glPatchParameteri(GL_PATCH_VERTICES, 3);
-    glDrawElementsInstanced(GL_PATCHES, app.scene.model.face_index_count, GL_UNSIGNED_SHORT, 0, app.scene.num_points);
-    glBindVertexArray(0);
-
-    glUseProgram(0);
-
-    glfwSwapBuffers(window);
+    FrameWriter &writer = app.writer;
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    printf("    writer: %zu of %d frames queued, %.1lf MB/s written, %u dropped\n", writer.jobs.size(), writer.queue_size,
+           (writer.bytes_written - writer.report_bytes_written) / (interval * 1.0e6), writer.num_dropped);
+    writer.report_bytes_written = writer.bytes_written;
 }
 
-void onKeyboard(GLFWwindow *window, int key, int scancode, int action, int mods)
+void finishFrameWriter(App &app)
 {
-    App *app_ptr = (App*)glfwGetWindowUserPointer(window);
+    // Drain the queue, then stop the workers
+    FrameWriter &writer = app.writer;
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.stopping = true;
+        writer.job_ready.notify_all();
+    }
+    size_t i;
+    for (i = 0; i < writer.threads.size(); i++)
+    {
+        writer.threads[i].join();
+    }
+    writer.threads.clear();
+    {
+        std::lock_guard<std::mutex> lock(writer.encoders.mutex);
+        writer.encoders.stopping = true;
+        writer.encoders.stripe_ready.notify_all();
+    }
+    for (i = 0; i < writer.encoders.threads.size(); i++)
+    {
+        writer.encoders.threads[i].join();
+    }
+    writer.encoders.threads.clear();
+    if (writer.stream != NULL)
+    {
+        fclose(writer.stream);
+        writer.stream = NULL;
+    }
 
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+    double elapsed = glfwGetTime() - writer.start_time;
+    printf("Wrote %u frames with %d threads (%.1lf MB/s, deepest queue %zu of %d, %u dropped)\n", writer.num_written, writer.num_threads,
+           writer.bytes_written / (elapsed * 1.0e6), writer.max_queue_depth, writer.queue_size, writer.num_dropped);
+    if (writer.format == OUTPUT_DELTA && writer.tiles_total > 0)
     {
-        saveImage("output/equirect.ppm", *app_ptr);
+        printf("Delta stream kept %llu of %llu tiles (%.1lf%%)\n", (unsigned long long)writer.tiles_changed,
+               (unsigned long long)writer.tiles_total, 100.0 * writer.tiles_changed / writer.tiles_total);
+    }
+    for (i = 0; i < writer.buffers.size(); i++)
+    {
+        delete[] writer.buffers[i];
     }
+    writer.buffers.clear();
+    writer.free_buffers.clear();
 }
 
-void saveImage(const char *filename, App &app)
+void loadShader(std::string shader_filename_base, App &app)
 {
-    uint8_t *pixels = new uint8_t[app.framebuffer_width * app.framebuffer_height * 3];
-#ifdef OFFSCREEN
-    glBindTexture(GL_TEXTURE_2D, app.framebuffer_texture);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-    glBindTexture(GL_TEXTURE_2D, 0);
-#else
-    glReadPixels(0, 0, app.framebuffer_width, app.framebuffer_height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-#endif
+    GlslProgram p;
+    loadProgram(shader_filename_base, p, app);
+
+    app.program = p.program;
+    app.uniforms = p.uniforms;
+}
+
+void loadProgram(std::string shader_filename_base, GlslProgram &glsl_program, App &app, std::vector<std::string> defines)
+{
+    // Use all shader stages that exist for `shader_filename_base`
+    const char *extensions[6] = {".vert", ".tesc", ".tese", ".geom", ".frag", ".comp"};
+    std::vector<std::string> shader_filenames;
     int i;
-    FILE *fp = fopen(filename, "wb");
-    fprintf(fp, "P6\n%d %d\n255\n", app.framebuffer_width, app.framebuffer_height);
-    for (i = app.framebuffer_height - 1; i >= 0; i --) {
-        fwrite(pixels + (i * app.framebuffer_width * 3), sizeof(uint8_t), app.framebuffer_width * 3, fp);
+    for (i = 0; i < 6; i++)
+    {
+        std::string filename = shader_filename_base + extensions[i];
+        if (fileExists(filename.c_str()))
+        {
+            shader_filenames.push_back(filename);
+        }
     }
-    fclose(fp);
-    delete[] pixels;
+
+    loadProgramFiles(shader_filenames, glsl_program, app, defines);
 }
 
-void loadShader(std::string shader_filename_base, App &app)
+void loadProgramFiles(std::vector<std::string> shader_filenames, GlslProgram &glsl_program, App &app,
+                      std::vector<std::string> defines, std::vector<std::string> feedback_varyings)
 {
-    // Read vertex and fragment shaders from file
-    char *vert_source, *tesc_source, *tese_source, *geom_source, *frag_source;
-    std::string vert_filename = shader_filename_base + ".vert";
-    std::string tesc_filename = shader_filename_base + ".tesc";
-    std::string tese_filename = shader_filename_base + ".tese";
-    std::string geom_filename = shader_filename_base + ".geom";
-    std::string frag_filename = shader_filename_base + ".frag";
-    int32_t vert_length = readFile(vert_filename.c_str(), &vert_source);
-    int32_t tesc_length = readFile(tesc_filename.c_str(), &tesc_source);
-    int32_t tese_length = readFile(tese_filename.c_str(), &tese_source);
-    int32_t geom_length = readFile(geom_filename.c_str(), &geom_source);
-    int32_t frag_length = readFile(frag_filename.c_str(), &frag_source);
-
-    // Compile vetex shader
-    GLuint vertex_shader = compileShader(vert_source, vert_length, GL_VERTEX_SHADER);
-    // Compile tessellation control shader
-    GLuint tess_ctrl_shader = compileShader(tesc_source, tesc_length, GL_TESS_CONTROL_SHADER);
-    // Compile tessellation evaluation shader
-    GLuint tess_eval_shader = compileShader(tese_source, tese_length, GL_TESS_EVALUATION_SHADER);
-    // Compile geometry shader
-    GLuint geometry_shader = compileShader(geom_source, geom_length, GL_GEOMETRY_SHADER);
-    // Compile fragment shader
-    GLuint fragment_shader = compileShader(frag_source, frag_length, GL_FRAGMENT_SHADER);
-
-    // Create GPU program from the compiled vertex and fragment shaders
-    GLuint shaders[5] = {vertex_shader, tess_ctrl_shader, tess_eval_shader, geometry_shader, fragment_shader};
-    app.program = createShaderProgram(shaders, 5);
+    // Read shaders from file and compile them (stage is determined by file extension)
+    GLuint shaders[6];
+    uint32_t num_shaders = 0;
+    uint32_t i;
+    for (i = 0; i < shader_filenames.size() && i < 6; i++)
+    {
+        char *source;
+        int32_t length = readFile(shader_filenames[i].c_str(), &source);
+        std::string defined_source = injectDefines(source, length, defines);
+        shaders[num_shaders] = compileShader(&defined_source[0], defined_source.length(), shaderTypeFromFilename(shader_filenames[i]));
+        free(source);
+        num_shaders++;
+    }
+
+    // Create GPU program from the compiled shaders
+    glsl_program.program = createShaderProgram(shaders, num_shaders);
+    glsl_program.uniforms_version = 0;
 
     // Specify input and output attributes for the GPU program
-    glBindAttribLocation(app.program, app.vertex_position_attrib, "vertex_position");
-    glBindAttribLocation(app.program, app.vertex_normal_attrib, "vertex_normal");
-    glBindAttribLocation(app.program, app.vertex_texcoord_attrib, "vertex_texcoord");
-    glBindAttribLocation(app.program, app.point_center_attrib, "point_center");
-    glBindAttribLocation(app.program, app.point_color_attrib, "point_color");
-    glBindAttribLocation(app.program, app.point_size_attrib, "point_size");
-    glBindFragDataLocation(app.program, 0, "FragColor");
+    glBindAttribLocation(glsl_program.program, app.vertex_position_attrib, "vertex_position");
+    glBindAttribLocation(glsl_program.program, app.vertex_normal_attrib, "vertex_normal");
+    glBindAttribLocation(glsl_program.program, app.vertex_texcoord_attrib, "vertex_texcoord");
+    glBindAttribLocation(glsl_program.program, app.point_center_attrib, "point_center");
+    glBindAttribLocation(glsl_program.program, app.point_color_attrib, "point_color");
+    glBindAttribLocation(glsl_program.program, app.point_size_attrib, "point_size");
+    glBindFragDataLocation(glsl_program.program, 0, "FragColor");
+
+    // Specify outputs that are recorded with transform feedback
+    if (feedback_varyings.size() > 0)
+    {
+        std::vector<const char*> varyings;
+        for (i = 0; i < feedback_varyings.size(); i++)
+        {
+            varyings.push_back(feedback_varyings[i].c_str());
+        }
+        glTransformFeedbackVaryings(glsl_program.program, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
 
     // Link compiled GPU program
-    linkShaderProgram(app.program);
+    linkShaderProgram(glsl_program.program);
+
+    // Shaders are no longer needed once linked into the program
+    for (i = 0; i < num_shaders; i++)
+    {
+        glDetachShader(glsl_program.program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
 
     // Get handles to uniform variables defined in the shaders
     GLint num_uniforms;
-    glGetProgramiv(app.program, GL_ACTIVE_UNIFORMS, &num_uniforms);
-    int i;
+    glGetProgramiv(glsl_program.program, GL_ACTIVE_UNIFORMS, &num_uniforms);
     GLchar uniform_name[65];
     GLsizei max_name_length = 64;
     GLsizei name_length;
     GLint size;
     GLenum type;
-    for (i = 0; i < num_uniforms; i++)
+    for (i = 0; i < (uint32_t)num_uniforms; i++)
     {
-        glGetActiveUniform(app.program, i, max_name_length, &name_length, &size, &type, uniform_name);
-        app.uniforms[uniform_name] = glGetUniformLocation(app.program, uniform_name);
+        glGetActiveUniform(glsl_program.program, i, max_name_length, &name_length, &size, &type, uniform_name);
+        glsl_program.uniforms[uniform_name] = glGetUniformLocation(glsl_program.program, uniform_name);
     }
 }
 
@@ -524,7 +5260,7 @@ GLuint createShaderProgram(GLuint shaders[], uint32_t num_shaders)
     GLuint program = glCreateProgram();
     
     // Attach all shaders to that program
-    int i;
+    uint32_t i;
     for (i = 0; i < num_shaders; i++)
     {
         glAttachShader(program, shaders[i]);
@@ -573,10 +5309,48 @@ std::string shaderTypeToString(GLenum type)
         case GL_FRAGMENT_SHADER:
             shader_type = "fragment";
             break;
+        case GL_COMPUTE_SHADER:
+            shader_type = "compute";
+            break;
     }
     return shader_type;
 }
 
+std::string injectDefines(const char *source, int32_t length, std::vector<std::string> &defines)
+{
+    // `#define`s must follow the `#version` line
+    std::string text(source, length);
+    if (defines.size() == 0)
+    {
+        return text;
+    }
+    size_t insert_pos = 0;
+    size_t version_pos = text.find("#version");
+    if (version_pos != std::string::npos)
+    {
+        insert_pos = text.find('\n', version_pos);
+        insert_pos = (insert_pos == std::string::npos) ? text.length() : insert_pos + 1;
+    }
+    std::string define_lines;
+    size_t i;
+    for (i = 0; i < defines.size(); i++)
+    {
+        define_lines += "#define " + defines[i] + "\n";
+    }
+    return text.insert(insert_pos, define_lines);
+}
+
+GLenum shaderTypeFromFilename(std::string filename)
+{
+    std::string extension = filename.substr(filename.rfind('.') + 1);
+    if (extension == "vert") return GL_VERTEX_SHADER;
+    if (extension == "tesc") return GL_TESS_CONTROL_SHADER;
+    if (extension == "tese") return GL_TESS_EVALUATION_SHADER;
+    if (extension == "geom") return GL_GEOMETRY_SHADER;
+    if (extension == "frag") return GL_FRAGMENT_SHADER;
+    return GL_COMPUTE_SHADER;
+}
+
 int32_t readFile(const char* filename, char** data_ptr)
 {
 	FILE *fp;
@@ -609,6 +5383,52 @@ int32_t readFile(const char* filename, char** data_ptr)
 	return fsize;
 }
 
+bool fileExists(const char *filename)
+{
+    std::ifstream file(filename);
+    return file.good();
+}
+
+void parseOptions(int argc, char **argv, std::vector<std::string> &args, std::map<std::string, std::string> &options)
+{
+    // `--name value` pairs are options (`--name` alone is a flag with value "1"), everything else is positional
+    int i;
+    for (i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.length() > 2 && arg.substr(0, 2) == "--")
+        {
+            std::string name = arg.substr(2);
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+            {
+                options[name] = argv[i + 1];
+                i++;
+            }
+            else
+            {
+                options[name] = "1";
+            }
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+}
+
+std::string getOption(std::map<std::string, std::string> &options, std::string name, std::string default_value)
+{
+    std::map<std::string, std::string>::iterator it = options.find(name);
+    return (it != options.end()) ? it->second : default_value;
+}
+
+GLint uniformLocation(std::map<std::string, GLint> &uniforms, std::string name)
+{
+    // Uniforms a program does not use are not in the map (-1 makes `glUniform*` a no-op)
+    std::map<std::string, GLint>::iterator it = uniforms.find(name);
+    return (it != uniforms.end()) ? it->second : -1;
+}
+
 GLuint createPlaneVao(GLuint position_attrib, GLuint normal_attrib, GLuint texcoord_attrib, GLuint *face_index_count)
 {
     // Create a new Vertex Array Object
@@ -1016,7 +5836,7 @@ GLuint createSphereVao(GLuint position_attrib, GLuint normal_attrib, GLuint texc
 
 GLuint createPointCloudVao(GLfloat *point_centers, GLfloat *point_colors, GLfloat *point_sizes, uint32_t num_points, GLuint position_attrib,
                            GLuint normal_attrib, GLuint texcoord_attrib, GLuint point_center_attrib, GLuint point_color_attrib,
-                           GLuint point_size_attrib, GLuint *face_index_count)
+                           GLuint point_size_attrib, GLuint *face_index_count, GLuint point_buffers[3])
 {
     // Create a new Vertex Array Object
     GLuint vertex_array;
@@ -1212,6 +6032,11 @@ GLuint createPointCloudVao(GLfloat *point_centers, GLfloat *point_colors, GLfloa
     // Store the number of vertices used for entire model (number of faces * 3)
     *face_index_count = 3 * num_faces;
 
+    // Store point buffers (also used as shader storage buffers by the compute renderer)
+    point_buffers[0] = point_center_buffer;
+    point_buffers[1] = point_color_buffer;
+    point_buffers[2] = point_size_buffer;
+
     // Return created Vertex Array Object
     return vertex_array;
 }